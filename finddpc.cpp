@@ -13,15 +13,34 @@ boost::vecS
 ,boost::property<boost::edge_index_t,size_t>
 >; 
 
-int main(){
+int main(int argc, char *argv[]){
 
 	using namespace gdraw;
 
+	auto usage = [](){
+		std::cout << "Usage: ./finddpc [<trees>] [<seed>] < <graph>" << std::endl; 
+		std::cout << "Where <trees> is the number of spanning trees searched concurrently (default 1) and <seed> seeds the first of them." << std::endl;
+		std::cout << "The seed of the tree that found the cover is written to stderr." << std::endl;
+	};
+
+	if(argc > 3){
+		usage();
+		return 0;
+	}
+
+	char* end = nullptr;
+	long trees = argc > 1 ? strtol(argv[1],&end,10) : 1;
+	if(trees < 1 || (end && *end != '\0')){
+		usage();
+		return 1;
+	}
+	seed_t seed = argc > 2 ? strtoul(argv[2],nullptr,10) : randomSeed();
+
 	auto g = IndexedGraph{readDOT<AdjList>()};
 
 	auto n = num_vertices(g.getGraph());
 
-	auto result = findDoublePlanarCover(std::move(g));
+	auto result = findDoublePlanarCoverPortfolio(std::move(g),trees,seed);
 
 	if(result){
 		auto dg = tuttePlanarDraw(std::move(result.value()));
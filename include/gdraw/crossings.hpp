@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+
+#include <gdraw/graph_types.hpp>
+#include <gdraw/coordinates.hpp>
+#include <gdraw/spatial_index.hpp>
+
+namespace gdraw{
+
+/**
+ * Counts the crossings of a drawing, where the edges with `edge_coordinates` are cubic Bézier curves and the others are straight lines.
+ * Pairs of edges with a common endpoint are not considered.
+ *
+ * The curves are flattened into polylines by the SpatialIndex of the drawing, and only its candidate pairs of segments are tested.
+ *
+ * @return : A tuple with the number of crossing points and the pairs of edges that cross.
+ */
+template <typename Graph>
+auto countCrossings(const DrawnGraph<Graph>& g, const SpatialIndex& index) -> std::tuple<size_t,std::vector<std::pair<edge_t<Graph>,edge_t<Graph>>>>{
+	std::vector<edge_t<Graph>> edges_by_index(g.numEdges());
+	for(auto&& e : g.edges())
+		edges_by_index[g.index(e)] = e;
+
+	size_t count = 0;
+	std::vector<std::pair<size_t,size_t>> crossing;
+	for(auto&& [i,j] : index.candidatePairs()){
+		auto& s = index.segment(i);
+		auto& t = index.segment(j);
+		if(SpatialIndex::segmentsCross(s,t)){
+			count++;
+			crossing.push_back(std::minmax(s.edge,t.edge));
+		}
+	}
+
+	std::sort(crossing.begin(),crossing.end());
+	crossing.erase(std::unique(crossing.begin(),crossing.end()),crossing.end());
+
+	std::vector<std::pair<edge_t<Graph>,edge_t<Graph>>> pairs;
+	for(auto&& [e,f] : crossing)
+		pairs.push_back({edges_by_index[e],edges_by_index[f]});
+
+	return std::make_tuple(count,std::move(pairs));
+}
+
+/**
+ * Counts the crossings of `g` with a new SpatialIndex.
+ */
+template <typename Graph>
+auto countCrossings(const DrawnGraph<Graph>& g, const size_t threads = 1) -> std::tuple<size_t,std::vector<std::pair<edge_t<Graph>,edge_t<Graph>>>>{
+	return countCrossings(g,SpatialIndex(g,threads));
+}
+
+}//namespace
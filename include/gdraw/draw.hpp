@@ -1,10 +1,15 @@
 #pragma once
 #include <string>
+#include <array>
+#include <future>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <bit>
 #include <armadillo>
 
-#include <boost/numeric/ublas/matrix.hpp>
-#include <boost/numeric/ublas/lu.hpp>
-#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include <boost/numeric/ublas/matrix_sparse.hpp>
+#include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/io.hpp>
 
 #include <boost/graph/boyer_myrvold_planar_test.hpp>
@@ -14,29 +19,39 @@
 #include <gdraw/graph_types.hpp>
 #include <gdraw/util.hpp>
 #include <gdraw/planar_graphs.hpp>
+#include <gdraw/solvers.hpp>
+#include <gdraw/spatial_index.hpp>
 
 namespace gdraw{
 
 /**
- * Returns the Laplacian Matrix of a graph g.
+ * Returns the Laplacian Matrix of a graph g as a sparse matrix.
  */
 template <typename Graph>
-auto laplacian(const IndexedGraph<Graph>& g){
+auto laplacian(const IndexedGraph<Graph>& g) -> arma::sp_mat{
 
-	arma::mat D(num_vertices(g.getGraph()),num_vertices(g.getGraph()),arma::fill::zeros);
+	auto n = g.numVertices();
+	arma::umat locations(2,4*g.numEdges());
+	arma::vec values(4*g.numEdges());
 
-	for(size_t i=0; i<num_vertices(g.getGraph()); i++){
-		D.diag()(i) = out_degree(vertex(i,g.getGraph()),g.getGraph());
-	}
+	size_t k=0;
+	auto add_entry = [&locations,&values,&k](auto i, auto j, double value){
+		locations(0,k) = i;
+		locations(1,k) = j;
+		values(k++) = value;
+	};
 
-	for(auto&& e : range(edges(g.getGraph()))){
-		auto [u,v] = endpoints(g.getGraph(),e);
+	//repeated locations are summed
+	for(auto&& e : g.edges()){
+		auto [u,v] = g.endpoints(e);
 		auto [i,j] = std::make_tuple(g.index(u),g.index(v));
-		D(i,j) = -1;
-		D(j,i) = D(u,v);
+		add_entry(i,j,-1);
+		add_entry(j,i,-1);
+		add_entry(i,i,1);
+		add_entry(j,j,1);
 	}
 
-	return D;
+	return arma::sp_mat(true,locations,values,n,n);
 }
 
 /**
@@ -62,65 +77,111 @@ auto not_in_cycle(const IndexedGraph<Graph>& g, const std::vector<vertex_t<Graph
 	return not_in_cycle;
 }
 
-/** Draws a graph according to Tutte's algorithm in 
- *  "How to draw a graph". Returns a vector containing
- *  the coordinates of g's vertices.
+/**
+ * Solves the system of Tutte's algorithm for the vertices of `g` not in `cycle`, starting from their entries in `coordinates`.
+ * The coordinates of the cycle vertices are fixed. 
+ *
+ * The sparse system is assembled from the edge list and solved for each coordinate with the preconditioned conjugate gradient method,
+ * until the residual is at most `tol` times the right hand side.
+ * If `multilevel` is set, a MultilevelPreconditioner is used instead of the Jacobi one.
  */
 template <typename Graph>
-auto tutteDrawImpl(IndexedGraph<Graph>& g,
-	       	std::vector<vertex_t<Graph>>& cycle,
-	       	std::vector<coord_t>& cycle_coordinates
-	       	){
-	auto L = laplacian(g);
-
-	arma::vec cx(g.numVertices(),arma::fill::zeros);
-	arma::vec cy(g.numVertices(),arma::fill::zeros);
-
-	for(size_t i=0; i<cycle_coordinates.size(); i++){
-		cx(cycle[i]) = cycle_coordinates[i].x ;
-		cy(cycle[i]) = cycle_coordinates[i].y ;
-
-	}
+auto tutteSolve(const IndexedGraph<Graph>& g,
+		const std::vector<vertex_t<Graph>>& cycle,
+		std::vector<coord_t> coordinates,
+		const bool multilevel = false,
+		const double tol = 1e-10
+		) -> std::vector<coord_t>{
+	auto n = g.numVertices();
+
+	std::vector<bool> in_cycle(n,false);
+	for(auto&& v : cycle)
+		in_cycle[g.index(v)] = true;
 
 	auto ncycle = not_in_cycle(g,cycle);
-	arma::uvec idx(ncycle.size());
+	if(ncycle.empty())
+		return coordinates;
 
+	std::vector<size_t> row(n,0);
 	for(size_t i =0; i< ncycle.size(); i++)
-		idx(i)=ncycle[i];
-
-	arma::uvec zero(1);
-	zero(0) = 0;
-
-	//strikeout the indices not in idx and invert it
-	arma::mat Li = arma::inv_sympd(L(idx,idx));
+		row[g.index(ncycle[i])] = i;
+
+	//rows of the laplacian for the vertices not in the cycle, 
+	//the columns of the cycle vertices go to the right hand side
+	std::vector<std::tuple<size_t,size_t,double>> entries;
+	arma::vec bx(ncycle.size(),arma::fill::zeros);
+	arma::vec by(ncycle.size(),arma::fill::zeros);
+
+	auto add_half_edge = [&](auto i, auto j){
+		if(in_cycle[i])
+			return;
+		entries.push_back({row[i],row[i],1});
+		if(in_cycle[j]){
+			bx(row[i]) += coordinates[j].x;
+			by(row[i]) += coordinates[j].y;
+		}
+		else
+			entries.push_back({row[i],row[j],-1});
+	};
 
-	arma::mat bx = L*(-1 * cx);
-	bx = bx.submat(idx,zero);
-	arma::mat by = L*(-1 * cy);
-	by = by.submat(idx,zero);
+	for(auto&& e : g.edges()){
+		auto [u,v] = g.endpoints(e);
+		add_half_edge(g.index(u),g.index(v));
+		add_half_edge(g.index(v),g.index(u));
+	}
 
-	arma::vec sbx = Li * bx;
-	arma::vec sby = Li * by;
+	arma::umat locations(2,entries.size());
+	arma::vec values(entries.size());
+	for(size_t k=0; k<entries.size(); k++){
+		auto [i,j,value] = entries[k];
+		locations(0,k) = i;
+		locations(1,k) = j;
+		values(k) = value;
+	}
 
-	arma::vec scx(g.numVertices(),arma::fill::zeros);
-	arma::vec scy(g.numVertices(),arma::fill::zeros);
+	//repeated locations are summed
+	arma::sp_mat A(true,locations,values,ncycle.size(),ncycle.size());
 
+	arma::vec x0(ncycle.size());
+	arma::vec y0(ncycle.size());
 	for(size_t i = 0; i<ncycle.size(); i++){
-		scx(ncycle[i]) = sbx(i);
-		scy(ncycle[i]) = sby(i);
+		x0(i) = coordinates[g.index(ncycle[i])].x;
+		y0(i) = coordinates[g.index(ncycle[i])].y;
 	}
 
-	scx = cx + scx;
-	scy = cy + scy;
+	auto solve = [&](auto&& precond){
+		arma::vec sx = conjugateGradient(A,bx,x0,precond,tol);
+		arma::vec sy = conjugateGradient(A,by,y0,precond,tol);
 
-	std::vector<coord_t> coordinates(g.numVertices());
-	for(size_t i =0; i<g.numVertices(); i++){
-		coordinates[i] = {scx(i),scy(i)};
-	}
+		for(size_t i = 0; i<ncycle.size(); i++)
+			coordinates[g.index(ncycle[i])] = {sx(i),sy(i)};
+	};
+
+	if(multilevel)
+		solve(MultilevelPreconditioner(std::move(A)));
+	else
+		solve(jacobiPreconditioner(A));
 
 	return coordinates;
 }
 
+/** Draws a graph according to Tutte's algorithm in 
+ *  "How to draw a graph". Returns a vector containing
+ *  the coordinates of g's vertices. See tutteSolve.
+ */
+template <typename Graph>
+auto tutteDrawImpl(IndexedGraph<Graph>& g,
+	       	std::vector<vertex_t<Graph>>& cycle,
+	       	std::vector<coord_t>& cycle_coordinates,
+		const bool multilevel = false
+	       	){
+	std::vector<coord_t> coordinates(g.numVertices(),{0,0});
+	for(size_t i=0; i<cycle_coordinates.size(); i++)
+		coordinates[g.index(cycle[i])] = cycle_coordinates[i];
+
+	return tutteSolve(g,cycle,std::move(coordinates),multilevel);
+}
+
 /**
  * Returns the coordinates of a convex polygon with 
  * cycle_size vertices and center (0,0).
@@ -180,6 +241,62 @@ auto tuttePlanarDraw(PlanarGraph<Graph> g) -> DrawnGraph<Graph>{
 	return DrawnGraph(std::move(g),std::move(coordinates));
 }
 
+/**
+ * Works like tuttePlanarDraw, but solves the system with multigrid V-cycles as preconditioner. 
+ * The outer facial cycle is fixed, so only the remaining vertices are coarsened. Meant for very large planar graphs.
+ */
+template <typename Graph>
+auto multilevelTutteDraw(PlanarGraph<Graph> g) -> DrawnGraph<Graph>{
+	auto facial_cycle = findLargestFacialCycle(g);
+	auto cycle_coordinates = drawCycle(facial_cycle.size());
+	auto coordinates = tutteDrawImpl(g,facial_cycle,cycle_coordinates,true);
+	return DrawnGraph(std::move(g),std::move(coordinates));
+}
+
+/**
+ * An edit for incrementalTutteDraw: adds or removes an edge between the vertices with indices `u` and `v`.
+ */
+struct GraphEdit{
+	enum Kind {AddEdge, RemoveEdge};
+
+	Kind kind;
+	size_t u;
+	size_t v;
+};
+
+/**
+ * Redraws a Tutte drawing after a few edits to its graph. The solver is warm-started from the previous coordinates
+ * and only iterates until the residual is at most `tol`, so small edits take a few iterations instead of a full solve.
+ *
+ * The vertices of `outer_cycle` keep their coordinates, and every edit should keep the graph planar with `outer_cycle` as a face.
+ * Removed edges lose their colors and their index is reused as in EdgeList. Meant for straight-line drawings.
+ */
+template <typename Graph>
+auto incrementalTutteDraw(DrawnGraph<Graph> dg, const std::vector<GraphEdit>& edits, const std::vector<vertex_t<Graph>>& outer_cycle, const double tol = 1e-8) -> DrawnGraph<Graph>{
+
+	EdgeList<Graph> edge_list(dg);
+
+	for(auto&& edit : edits){
+		auto u = dg.vertex(edit.u);
+		auto v = dg.vertex(edit.v);
+		if(edit.kind == GraphEdit::AddEdge)
+			edge_list.addEdge(u,v);
+		else if(auto e = dg.edge(u,v)){
+			//the last edge takes the index of the removed one
+			dg.moveEdgeAttributes(edge_list.ecount-1,dg.index(e.value()));
+			edge_list.removeEdge(e.value());
+		}
+	}
+
+	dg.coordinates = tutteSolve(dg,outer_cycle,std::move(dg.coordinates),false,tol);
+	return dg;
+}
+
+/**
+ * Builds the sparse system of Tutte's algorithm for the vertices not in `polygon`, a range of (vertex,coordinate) pairs.
+ *
+ * @return : A tuple with the matrix, the right hand sides for x and y and a map from vertices to rows.
+ */
 template <typename Graph,typename DrawnCycle>
 auto buildSystem(const Graph& g,
 	       	const DrawnCycle& polygon){
@@ -187,16 +304,16 @@ auto buildSystem(const Graph& g,
 	std::vector<size_t> vertex_to_row(num_vertices(g));
 	size_t size = num_vertices(g) - polygon.size();
 
-	boost::numeric::ublas::matrix<double> A(size,size);
+	boost::numeric::ublas::compressed_matrix<double> A(size,size);
 	boost::numeric::ublas::vector<double> bx(size);
 	boost::numeric::ublas::vector<double> by(size);
+	bx.clear();
+	by.clear();
 
 	std::vector<std::pair<bool,coord_t>> in_polygon(num_vertices(g),std::make_pair(false,coord_t{0,0}));
-	//std::cout << "In Polygon: " << std::endl;
 	for(auto&& [u,coord] : polygon){
 		in_polygon[u].first = true;
 		in_polygon[u].second = coord;
-		//std::cout << u << " " << coord << std::endl;
 	}
 
 	int row=0;
@@ -204,23 +321,17 @@ auto buildSystem(const Graph& g,
 		if(!in_polygon[v].first)
 			vertex_to_row[v]=row++;
 
-
+	//rows are filled in order, so the entries are appended
 	for (auto&& v : range(vertices(g))){
-		//std::cout << "Vertex: " << v << std::endl;
 		if(!in_polygon[v].first){
 			A(vertex_to_row[v],vertex_to_row[v]) = out_degree(v,g);
-			//std::cout << "To Row: " << vertex_to_row[v] << std::endl;
-			//std::cout << A << std::endl;
 			for(auto&& e : range(out_edges(v,g))){
 				auto u = target(e,g);
-				//std::cout << "target: " << target(*ei,g) << std::endl;
-				//std::cout << "source: " << u << std::endl;
 				if(in_polygon[u].first){
 					bx[vertex_to_row[v]] += in_polygon[u].second.x;
 					by[vertex_to_row[v]] += in_polygon[u].second.y;
 				}else{
-					A(vertex_to_row[v],vertex_to_row[u])=-1;
-
+					A(vertex_to_row[v],vertex_to_row[u]) -= 1;
 				}
 			}
 		}
@@ -229,18 +340,187 @@ auto buildSystem(const Graph& g,
 }
 
 /**
- * Solves a system of linear equations of the form Ax=b.
- * The vector b is modified and contains the solution.
+ * Solves the system of Tutte's algorithm for a fixed graph and polygon. 
+ *
+ * The system is built once with buildSystem, its rows are reordered with reverse Cuthill-McKee
+ * and it is factorized once with a Cholesky factorization stored in skyline (envelope) form.
+ * Each solve is then a pair of triangular substitutions per coordinate, which can be done in parallel.
+ * New coordinates for the polygon vertices only change the right hand sides, so they reuse the factorization.
  */
-void
-solveSystem(boost::numeric::ublas::matrix<double>& A,
-	       	boost::numeric::ublas::vector<double>& b){
+template <typename Graph>
+class TutteSolver{
+
+	public:
+		template <typename DrawnCycle>
+		TutteSolver(const Graph& g, const DrawnCycle& polygon): vertex_count(num_vertices(g)){
+			auto [A,bx,by,vertex_to_row] = buildSystem(g,polygon);
+			size = A.size1();
+
+			std::vector<bool> in_polygon(vertex_count,false);
+			for(auto&& [u,coord] : polygon){
+				polygon_vertices.push_back(u);
+				polygon_coordinates.push_back(coord);
+				in_polygon[u] = true;
+			}
+
+			//the rows coupled with each vertex of the polygon
+			for(size_t i=0; i<polygon_vertices.size(); i++)
+				for(auto&& e : range(out_edges(polygon_vertices[i],g))){
+					auto v = target(e,g);
+					if(!in_polygon[v])
+						coupling.push_back({vertex_to_row[v],i});
+				}
 
-	boost::numeric::ublas::permutation_matrix<size_t> pm(A.size1());
-	lu_factorize(A,pm);
+			row_to_vertex.resize(size);
+			for(size_t v=0; v<vertex_count; v++)
+				if(!in_polygon[v])
+					row_to_vertex[vertex_to_row[v]] = v;
 
-	lu_substitute(A,pm,b);
-}
+			std::vector<std::vector<std::pair<size_t,double>>> rows(size);
+			for(auto i1 = A.begin1(); i1 != A.end1(); ++i1)
+				for(auto i2 = i1.begin(); i2 != i1.end(); ++i2)
+					rows[i2.index1()].push_back({i2.index2(),*i2});
+
+			order(rows);
+			factorize(rows);
+		}
+
+		/**
+		 * Returns the coordinates of all the vertices with the polygon coordinates given at construction.
+		 */
+		auto solve(bool parallel = false) const -> std::vector<coord_t>{
+			return solve(polygon_coordinates,parallel);
+		}
+
+		/**
+		 * Returns the coordinates of all the vertices with new coordinates for the polygon, given in the same order.
+		 */
+		auto solve(const std::vector<coord_t>& new_polygon_coordinates, bool parallel = false) const -> std::vector<coord_t>{
+			std::vector<double> bx(size,0);
+			std::vector<double> by(size,0);
+			for(auto&& [row,i] : coupling){
+				bx[position[row]] += new_polygon_coordinates[i].x;
+				by[position[row]] += new_polygon_coordinates[i].y;
+			}
+
+			if(parallel){
+				auto x = std::async(std::launch::async,[this,&bx](){ substitute(bx); });
+				substitute(by);
+				x.get();
+			}
+			else{
+				substitute(bx);
+				substitute(by);
+			}
+
+			std::vector<coord_t> coordinates(vertex_count);
+			for(size_t i=0; i<polygon_vertices.size(); i++)
+				coordinates[polygon_vertices[i]] = new_polygon_coordinates[i];
+			for(size_t row=0; row<size; row++)
+				coordinates[row_to_vertex[row]] = {bx[position[row]],by[position[row]]};
+
+			return coordinates;
+		}
+
+	private:
+		size_t vertex_count;
+		size_t size;
+
+		std::vector<size_t> polygon_vertices;
+		std::vector<coord_t> polygon_coordinates;
+		std::vector<std::pair<size_t,size_t>> coupling;
+		std::vector<size_t> row_to_vertex;
+
+		//position of each row after reordering
+		std::vector<size_t> position;
+
+		//row i of the factor holds the columns first[i]..i at offsets[i]..offsets[i+1]-1
+		std::vector<size_t> first;
+		std::vector<size_t> offsets;
+		std::vector<double> factor;
+
+		//reverse Cuthill-McKee, reduces the envelope of the matrix
+		auto order(const std::vector<std::vector<std::pair<size_t,double>>>& rows) -> void{
+			std::vector<size_t> sequence;
+			std::vector<bool> visited(size,false);
+			auto degree = [&rows](auto i){ return rows[i].size(); };
+
+			std::vector<size_t> by_degree(size);
+			std::iota(by_degree.begin(),by_degree.end(),0);
+			std::stable_sort(by_degree.begin(),by_degree.end(),[&](auto i,auto j){ return degree(i) < degree(j); });
+
+			for(auto&& root : by_degree){
+				if(visited[root])
+					continue;
+				visited[root] = true;
+				auto level_start = sequence.size();
+				sequence.push_back(root);
+				for(auto k = level_start; k<sequence.size(); k++){
+					std::vector<size_t> next;
+					for(auto&& [j,a] : rows[sequence[k]])
+						if(!visited[j]){
+							visited[j] = true;
+							next.push_back(j);
+						}
+					std::stable_sort(next.begin(),next.end(),[&](auto i,auto j){ return degree(i) < degree(j); });
+					sequence.insert(sequence.end(),next.begin(),next.end());
+				}
+			}
+
+			position.resize(size);
+			for(size_t k=0; k<size; k++)
+				position[sequence[size-1-k]] = k;
+		}
+
+		auto factorize(const std::vector<std::vector<std::pair<size_t,double>>>& rows) -> void{
+			first.assign(size,0);
+			for(size_t i=0; i<size; i++)
+				first[position[i]] = position[i];
+			for(size_t i=0; i<size; i++)
+				for(auto&& [j,a] : rows[i])
+					first[position[i]] = std::min(first[position[i]],position[j]);
+
+			offsets.resize(size+1);
+			offsets[0] = 0;
+			for(size_t i=0; i<size; i++)
+				offsets[i+1] = offsets[i] + i - first[i] + 1;
+
+			factor.assign(offsets[size],0);
+			auto at = [this](size_t i, size_t j) -> double&{
+				return factor[offsets[i] + j - first[i]];
+			};
+
+			for(size_t i=0; i<size; i++)
+				for(auto&& [j,a] : rows[i])
+					if(position[j] <= position[i])
+						at(position[i],position[j]) = a;
+
+			//the envelope of the factor is the envelope of the matrix
+			for(size_t i=0; i<size; i++){
+				for(size_t j=first[i]; j<=i; j++){
+					double sum = at(i,j);
+					for(size_t k=std::max(first[i],first[j]); k<j; k++)
+						sum -= at(i,k)*at(j,k);
+					at(i,j) = j<i ? sum/at(j,j) : std::sqrt(sum);
+				}
+			}
+		}
+
+		//solves L L^T x = b in place
+		auto substitute(std::vector<double>& b) const -> void{
+			for(size_t i=0; i<size; i++){
+				double sum = b[i];
+				for(size_t j=first[i]; j<i; j++)
+					sum -= factor[offsets[i] + j - first[i]] * b[j];
+				b[i] = sum / factor[offsets[i+1]-1];
+			}
+			for(size_t i=size; i-- > 0;){
+				b[i] /= factor[offsets[i+1]-1];
+				for(size_t j=first[i]; j<i; j++)
+					b[j] -= factor[offsets[i] + j - first[i]] * b[i];
+			}
+		}
+};
 
 /**
  * Draws a given planar graph using the algorithm by W. Tutte in "How to Draw a Graph".
@@ -252,48 +532,27 @@ template <typename Graph,typename Range>
 requires VertexRange<Range,Graph>
 auto tutteDrawBoostImpl(PlanarGraph<Graph> g, const Range& facial_cycle) -> DrawnGraph<Graph>{
 
-	//copy graph here, we don't want the extra edges...
-	auto g_maximal = makeMaximal(g);
-
-	std::vector<coord_t> coordinates(num_vertices(g_maximal.getGraph()));
-
-	auto drawn_cycle = drawCycle<Graph>(facial_cycle);
-
-	std::vector<bool> in_cycle(num_vertices(g_maximal.getGraph()),false);
-
-	for(auto p : drawn_cycle){
-		coordinates[p.first] = p.second;
-		in_cycle[p.first] = true;
-	}
-
-	auto [A,bx,by,vertex_to_row] = buildSystem(g.getGraph(),drawn_cycle);
-	
-	solveSystem(A,bx);
-	solveSystem(A,by);
+	auto cycle_coordinates = drawCycle(facial_cycle.size());
 
-	auto not_in_cycle = [&in_cycle](auto&& p){
-		return not in_cycle[p];
-	};
+	std::vector<std::pair<vertex_t<Graph>,coord_t>> drawn_cycle;
+	for(size_t i=0; auto&& v : facial_cycle)
+		drawn_cycle.push_back({v,cycle_coordinates[i++]});
 
-	//TODO would like a better solution to this, without using enumerate
-	for(size_t v=0;v!=vertex_to_row.size();v++){
-		auto i = vertex_to_row[v];
-		if(not_in_cycle(v))
-			coordinates[v] = {bx(i),by(i)};
-	}
+	TutteSolver<Graph> solver(g.getGraph(),drawn_cycle);
+	auto coordinates = solver.solve(true);
 
-	return DrawnGraph<Graph>(std::move(g),coordinates);
+	return DrawnGraph<Graph>(std::move(g),std::move(coordinates));
 }
 
 /**
  * Draws a planar graph using the algorithm by W. Tutte in "How to Draw a Graph".
  *
- * Works just like tutteDraw(g,facial_cycle) but this one finds a cycle for you.
+ * Works just like tutteDrawBoostImpl(g,facial_cycle) but this one finds a cycle for you.
  */
 template <typename Graph>
 auto tutteDrawBoost(PlanarGraph<Graph> g) -> DrawnGraph<Graph>{
-	auto facial_cycle = findFacialCycle(g);
-	return tutteDraw(std::move(g),facial_cycle);
+	auto facial_cycle = findLargestFacialCycle(g);
+	return tutteDrawBoostImpl(std::move(g),facial_cycle);
 }
 
 
@@ -320,6 +579,187 @@ auto chrobakPayneDraw(PlanarGraph<Graph>& g) -> DrawnGraph<Graph>{
 	return DrawnGraph<Graph>(std::move(g),coordinates);
 }
 
+/**
+ * Draws a connected planar graph with straight lines on the (n-2)x(n-2) integer grid, with the algorithm of W. Schnyder in "Embedding planar graphs on the grid".
+ *
+ * The graph is triangulated with makeMaximal, and the outer face is the first face at vertex 0. A canonical ordering is found by contracting
+ * the edges of the first outer vertex, keeping track of the chords of its neighbors, and gives the three trees of a Schnyder wood.
+ * The coordinates of a vertex are the number of vertices in two of its three regions minus the length of a path,
+ * which are computed from subtree sizes summed along the paths of the trees. Every step after the triangulation takes linear time.
+ *
+ * Can be used as a draw method for drawFlattenedGraph.
+ */
+template <typename Graph>
+auto schnyderDraw(PlanarGraph<Graph> g) -> DrawnGraph<Graph>{
+	auto n = g.numVertices();
+	if(n < 3){
+		std::vector<coord_t> coordinates;
+		for(size_t i=0; i<n; i++)
+			coordinates.push_back({(double)i,0});
+		return DrawnGraph<Graph>(std::move(g),std::move(coordinates));
+	}
+
+	std::vector<std::vector<size_t>> neighbors(n);
+	{
+		auto g_maximal = makeMaximal(g);
+		for(size_t v=0; v<n; v++)
+			for(auto&& e : g_maximal.rotations[v]){
+				auto [a,b] = g_maximal.endpoints(e);
+				neighbors[v].push_back(g_maximal.index(a) != v ? g_maximal.index(a) : g_maximal.index(b));
+			}
+	}
+
+	//outer face
+	const size_t a1 = 0;
+	const size_t a2 = neighbors[a1][0];
+	const size_t a3 = neighbors[a1][1];
+	const size_t none = n;
+
+	//the contour is the path of neighbors of a1 from a2 to a3
+	std::vector<size_t> prev(n,none), next(n,none);
+	std::vector<bool> on_contour(n,false);
+	std::vector<int> chords(n,0);
+	{
+		auto& ring = neighbors[a1];
+		std::vector<size_t> path{a2};
+		for(size_t i=ring.size()-1; i>=1; i--)
+			path.push_back(ring[i]);
+		for(size_t i=0; i<path.size(); i++){
+			on_contour[path[i]] = true;
+			if(i > 0)
+				prev[path[i]] = path[i-1];
+			if(i+1 < path.size())
+				next[path[i]] = path[i+1];
+		}
+		for(auto&& w : path)
+			for(auto&& y : neighbors[w])
+				if(y != a1 && on_contour[y] && y != prev[w] && y != next[w])
+					chords[w]++;
+	}
+
+	//the three parents of each inner vertex
+	std::array<std::vector<size_t>,3> parent;
+	parent.fill(std::vector<size_t>(n,none));
+	for(size_t v=0; v<n; v++)
+		if(on_contour[v])
+			parent[0][v] = a1;
+
+	std::vector<size_t> order;
+	std::vector<size_t> candidates;
+	for(size_t v=0; v<n; v++)
+		if(on_contour[v] && v != a2 && v != a3 && chords[v] == 0)
+			candidates.push_back(v);
+
+	while(!candidates.empty()){
+		auto x = candidates.back();
+		candidates.pop_back();
+		if(!on_contour[x] || chords[x] != 0)
+			continue;
+
+		auto l = prev[x], r = next[x];
+		parent[1][x] = l;
+		parent[2][x] = r;
+		on_contour[x] = false;
+		order.push_back(x);
+
+		//the neighbors of x between l and r, away from a1 and the vertices already contracted into it
+		auto& ring = neighbors[x];
+		auto d = ring.size();
+		size_t i = std::find(ring.begin(),ring.end(),l) - ring.begin();
+		auto y = ring[(i+1)%d];
+		size_t step = y == a1 || (y != x && parent[1][y] != none) ? d-1 : 1;
+		std::vector<size_t> exposed;
+		for(auto j = (i+step)%d; ring[j] != r; j = (j+step)%d)
+			exposed.push_back(ring[j]);
+
+		if(exposed.empty()){
+			//l-r was a chord
+			next[l] = r;
+			prev[r] = l;
+			chords[l]--;
+			chords[r]--;
+		}
+		else{
+			auto last = l;
+			for(auto&& w : exposed){
+				next[last] = w;
+				prev[w] = last;
+				on_contour[w] = true;
+				parent[0][w] = x;
+				last = w;
+			}
+			next[last] = r;
+			prev[r] = last;
+
+			for(auto&& w : exposed)
+				for(auto&& y : neighbors[w])
+					if(y != a1 && on_contour[y] && y != prev[w] && y != next[w]){
+						chords[w]++;
+						//chords between two exposed vertices are counted from both ends
+						if(std::find(exposed.begin(),exposed.end(),y) == exposed.end())
+							chords[y]++;
+					}
+		}
+
+		for(auto&& v : {l,r})
+			if(v != a2 && v != a3 && chords[v] == 0)
+				candidates.push_back(v);
+		for(auto&& w : exposed)
+			if(chords[w] == 0)
+				candidates.push_back(w);
+	}
+
+	//subtree sizes in each tree, and sums of subtree sizes and lengths along the paths to the roots
+	std::array<std::vector<size_t>,3> size;
+	size.fill(std::vector<size_t>(n,0));
+	for(auto&& v : order)
+		for(auto&& s : size)
+			s[v] = 1;
+	//the children of a vertex in the first tree are removed after it, and in the others before it
+	for(auto it = order.rbegin(); it != order.rend(); ++it)
+		size[0][parent[0][*it]] += size[0][*it];
+	for(auto&& v : order)
+		for(size_t t=1; t<3; t++)
+			size[t][parent[t][v]] += size[t][v];
+
+	//sum[t][i][v] is the sum of the sizes in tree i along the path of v in tree t
+	std::array<std::array<std::vector<size_t>,3>,3> sum;
+	std::array<std::vector<size_t>,3> length;
+	for(size_t t=0; t<3; t++){
+		length[t].assign(n,0);
+		for(size_t i=0; i<3; i++)
+			sum[t][i].assign(n,0);
+	}
+	auto accumulate = [&](size_t t, size_t v){
+		auto p = parent[t][v];
+		auto outer = p == a1 || p == a2 || p == a3;
+		length[t][v] = 1 + (outer ? 0 : length[t][p]);
+		for(size_t i=0; i<3; i++)
+			sum[t][i][v] = size[i][v] + (outer ? 0 : sum[t][i][p]);
+	};
+	for(auto&& v : order)
+		accumulate(0,v);
+	for(auto it = order.rbegin(); it != order.rend(); ++it){
+		accumulate(1,*it);
+		accumulate(2,*it);
+	}
+
+	std::vector<coord_t> coordinates(n);
+	coordinates[a1] = {(double)n-2,1};
+	coordinates[a2] = {0,(double)n-2};
+	coordinates[a3] = {1,0};
+	for(auto&& v : order){
+		//the region opposite to root i is bounded by the paths to the other two roots
+		auto region = [&](size_t i){
+			auto j = (i+1)%3, k = (i+2)%3;
+			return sum[j][i][v] + sum[k][i][v] - size[i][v] + 2;
+		};
+		coordinates[v] = {(double)(region(0) - (length[2][v]+1)),(double)(region(1) - (length[0][v]+1))};
+	}
+
+	return DrawnGraph<Graph>(std::move(g),std::move(coordinates));
+}
+
 inline auto crossingSpline(const coord_t& xpoint, const std::pair<coord_t,coord_t>& e, const float epsilon=0.2) -> cubicSpline {
 	const coord_t p1 {xpoint.x + (e.first.x - xpoint.x ) * epsilon, xpoint.y +  (e.first.y - xpoint.y) * epsilon};
 	//coord_t p2 {xpoint.x + (e.first.x - xpoint.x ) * epsilon/2, xpoint.y +  (e.first.y - xpoint.y) * epsilon/2};
@@ -328,61 +768,80 @@ inline auto crossingSpline(const coord_t& xpoint, const std::pair<coord_t,coord_
 	return spline;
 }
 
+/**
+ * Draws a planarization `g` with `draw_method` and turns its dummy vertices, those with index `original_vcount` or more, back into crossings.
+ * Each chain of edges through dummy vertices becomes one edge with the smallest index of the chain, drawn as a cubic spline that leaves 
+ * towards the first crossing and arrives from the last one. 
+ *
+ * The output graph is built directly, following each chain once, so flattening takes linear time.
+ */
 template <typename Graph>
 auto drawFlattenedGraph(PlanarGraph<Graph> g, size_t original_vcount, std::function<DrawnGraph<Graph>(PlanarGraph<Graph>)> draw_method = tuttePlanarDraw<Graph>) -> DrawnGraph<Graph>{
 
-	auto rotations {g.rotations};
-
-	std::map<edge_t<Graph>,cubicSpline> xcoordinates;
+	//only the rotations of the dummy vertices are needed, by edge index
+	auto n = g.numVertices();
+	std::vector<std::array<size_t,4>> crossings(n > original_vcount ? n - original_vcount : 0);
+	for(auto u = original_vcount; u < n; u++)
+		for(size_t i=0; i<4; i++)
+			crossings[u - original_vcount][i] = g.index(g.rotations[u][i]);
 
 	auto dg = draw_method(std::move(g));
 
+	size_t max_index = 0;
+	for(auto&& e : dg.edges())
+		max_index = std::max(max_index,(size_t)dg.index(e));
+	std::vector<edge_t<Graph>> edges_by_index(max_index+1);
+	for(auto&& e : dg.edges())
+		edges_by_index[dg.index(e)] = e;
 
 	auto other_endpoint = [&dg](auto&& u, auto&& e){
-		return target(e,dg.getGraph()) != u ? target(e,dg.getGraph()) : source(e,dg.getGraph());
+		auto [a,b] = dg.endpoints(e);
+		return a != u ? a : b;
 	};
-
-	auto edgei_map = get(boost::edge_index, dg.getGraph());
-
-	auto min_index = [&dg,&edgei_map](auto&& e, auto&& f){
-		auto ei = boost::get(edgei_map,e);
-		auto fi = boost::get(edgei_map,f);
-		return std::min(ei,fi);
+	auto dummy = [&dg,original_vcount](auto&& u){
+		return dg.index(u) >= original_vcount;
 	};
 
-	for(auto u = original_vcount; u < num_vertices(dg.getGraph()); u++){
-		//std::cout << u << std::endl;
-		auto pi_u = rotations[u];
-		auto v = other_endpoint(u,pi_u[0]);
-		auto w = other_endpoint(u,pi_u[2]);
-
-		auto a = other_endpoint(u,pi_u[1]);
-		auto b = other_endpoint(u,pi_u[3]);
-
-		//auto e = edge(v,w,dg.getGraph()).first;
-		//auto f = edge(a,b,dg.getGraph()).first;
-		
-		auto ei = min_index(pi_u[0],pi_u[2]);
-		auto fi = min_index(pi_u[1],pi_u[3]);
-
-		clear_vertex(u,dg.getGraph());
-
-		auto e = add_edge(v,w,dg.getGraph()).first;
-		auto f = add_edge(a,b,dg.getGraph()).first;
-
-		boost::put(edgei_map,e,ei);
-		boost::put(edgei_map,f,fi);
-		
-		auto espline = crossingSpline(dg.coordinates[u],std::make_pair(dg.coordinates[v],dg.coordinates[w]));
-		auto fspline = crossingSpline(dg.coordinates[u],std::make_pair(dg.coordinates[a],dg.coordinates[b]));
+	IndexedGraph<Graph> flat{Graph(std::min(n,original_vcount))};
+	IndexMap<cubicSpline> xcoordinates;
+	auto& coordinates = dg.coordinates;
+
+	for(auto&& e : dg.edges()){
+		auto [a,b] = dg.endpoints(e);
+		//chains are followed from one of their original endpoints
+		auto x = dummy(a) ? b : a;
+		if(dummy(x))
+			continue;
+
+		auto f = e;
+		auto y = other_endpoint(x,e);
+		auto index = dg.index(e);
+		auto first = y, last = y;
+		while(dummy(y)){
+			auto& rotation = crossings[dg.index(y) - original_vcount];
+			auto i = std::find(rotation.begin(),rotation.end(),dg.index(f)) - rotation.begin();
+			f = edges_by_index[rotation[(i+2)%4]];
+			index = std::min(index,dg.index(f));
+			last = y;
+			y = other_endpoint(y,f);
+		}
 
-		xcoordinates.insert({e,espline});
-		xcoordinates.insert({f,fspline});
+		//each chain is found from both ends
+		if(f != e && dg.index(f) < dg.index(e))
+			continue;
+
+		flat.addEdge(flat.vertex(dg.index(x)),flat.vertex(dg.index(y)),index);
+		if(f != e){
+			auto from = coordinates[dg.index(x)];
+			auto to = coordinates[dg.index(y)];
+			auto leave = crossingSpline(coordinates[dg.index(first)],{from,to});
+			auto arrive = crossingSpline(coordinates[dg.index(last)],{from,to});
+			xcoordinates.set(index,cubicSpline(from,leave.control1,arrive.control2,to));
+		}
 	}
-	gdraw::removeIsolatedVertices(dg.getGraph());
-
-	return DrawnGraph(std::move(dg), std::move(dg.coordinates), std::move(xcoordinates));;
 
+	coordinates.resize(flat.numVertices());
+	return DrawnGraph(std::move(flat), std::move(coordinates), std::move(xcoordinates));
 }
 
 auto intersect(coord_t a,coord_t b, coord_t c, coord_t d) -> bool{
@@ -398,35 +857,188 @@ auto intersect(coord_t a,coord_t b, coord_t c, coord_t d) -> bool{
 	 (0 + std::numeric_limits<double>::epsilon() <= t && t <= 1-std::numeric_limits<double>::epsilon());
 }
 
-//TODO could use the nlog n multiple line intersection algorithm here...
+/**
+ * A dynamic set of closed intervals over `ranks` coordinates, given by the ranks of their ends, that reports the intervals overlapping a query interval.
+ * The intervals containing the lower end of the query lie on the leaf-to-root path of a segment tree, where each interval is kept in O(log m) nodes,
+ * and those starting above it are found in a tree ordered by their lower ends. Inserting or erasing takes O(log m), and a query O(log m + k) for k intervals reported.
+ */
+class IntervalSet{
+	public:
+		IntervalSet(size_t ranks, size_t intervals): leaves(std::bit_ceil(std::max(ranks,(size_t)1))), nodes(2*leaves), where(intervals), lows(intervals){}
+
+		/**
+		 * Inserts interval `i` covering the ranks from `low` to `high`.
+		 */
+		void insert(size_t i, size_t low, size_t high){
+			lows[i] = low;
+			starts.insert({low,i});
+			for(size_t l = low + leaves, r = high + leaves + 1; l < r; l /= 2, r /= 2){
+				if(l%2)
+					add(i,l++);
+				if(r%2)
+					add(i,--r);
+			}
+		}
+
+		void erase(size_t i){
+			starts.erase({lows[i],i});
+			for(auto&& [node,position] : where[i]){
+				auto& items = nodes[node];
+				auto [j,slot] = items.back();
+				items[position] = {j,slot};
+				where[j][slot].second = position;
+				items.pop_back();
+			}
+			where[i].clear();
+		}
+
+		/**
+		 * Calls `f` once on every interval overlapping the ranks from `low` to `high`.
+		 */
+		void overlapping(size_t low, size_t high, auto&& f) const{
+			for(size_t node = low + leaves; node > 0; node /= 2)
+				for(auto&& [i,slot] : nodes[node])
+					f(i);
+			for(auto it = starts.upper_bound({low,std::numeric_limits<size_t>::max()}); it != starts.end() && it->first <= high; it++)
+				f(it->second);
+		}
+
+	private:
+		size_t leaves;
+		//the intervals at each node with their slot in `where`, and the nodes of each interval with the position in them
+		std::vector<std::vector<std::pair<size_t,size_t>>> nodes;
+		std::vector<std::vector<std::pair<size_t,size_t>>> where;
+		std::vector<size_t> lows;
+		std::set<std::pair<size_t,size_t>> starts;
+
+		void add(size_t i, size_t node){
+			nodes[node].push_back({i,where[i].size()});
+			where[i].push_back({node,nodes[node].size()-1});
+		}
+};
+
+/**
+ * Returns the pairs of non-adjacent edges whose straight-line segments cross. If `first_only` is set it stops at the first pair found.
+ *
+ * The segments are sorted by their leftmost x and swept from left to right. The active segments, i.e. those whose x-interval reaches the sweep,
+ * leave in order of their rightmost x through a heap and are kept in an IntervalSet on their y-intervals, so each segment is only tested
+ * against the active ones whose bounding box meets its own. With K such pairs, the sweep takes O(m log m + K) time.
+ */
 template <typename Graph>
-auto isStraightLineDrawing(const DrawnGraph<Graph>& g) -> bool{
-	auto cross = [&g](auto e,auto f){
-		auto [u_e,v_e] = g.endpoints(e);
-		auto [u_f,v_f] = g.endpoints(f);
-		return intersect(g.coordinates[g.index(u_e)],
-				g.coordinates[g.index(v_e)],
-				g.coordinates[g.index(u_f)],
-				g.coordinates[g.index(v_f)]);
+auto crossingPairs(const DrawnGraph<Graph>& g, const bool first_only = false) -> std::vector<std::pair<edge_t<Graph>,edge_t<Graph>>>{
+	struct Segment{
+		edge_t<Graph> e;
+		size_t u;
+		size_t v;
+		double min_x;
+		double max_x;
+		size_t min_y;
+		size_t max_y;
 	};
 
-	auto common_endpoint = [&g](auto e, auto f){
-		auto [a,b] = g.endpoints(e);
-		auto [x,y] = g.endpoints(f);
-		return (x==a || x==b || y==a || y==b);
+	std::vector<double> ys;
+	ys.reserve(2*g.numVertices());
+	for(auto&& v : g.vertices())
+		ys.push_back(g.coordinates[g.index(v)].y);
+	std::sort(ys.begin(),ys.end());
+	ys.erase(std::unique(ys.begin(),ys.end()),ys.end());
+	auto rank = [&ys](double y) -> size_t{
+		return std::lower_bound(ys.begin(),ys.end(),y) - ys.begin();
 	};
 
-	for(auto&& c : iter::combinations(g.edges(),2)){
-		auto e = *(c.begin());
-		auto f = *(c.begin()+1);
-		//std::cout << e << ' ' << f << ' ' << std::boolalpha << cross(e,f) << std::endl;
-		if(!common_endpoint(e,f) && cross(e,f)){
-			//std::cout << e << 'x' << f << std::endl;
-			return false;
+	std::vector<Segment> segments;
+	segments.reserve(g.numEdges());
+	for(auto&& e : g.edges()){
+		auto [u,v] = g.endpoints(e);
+		auto& a = g.coordinates[g.index(u)];
+		auto& b = g.coordinates[g.index(v)];
+		segments.push_back({e,g.index(u),g.index(v),
+				std::min(a.x,b.x),std::max(a.x,b.x),
+				rank(std::min(a.y,b.y)),rank(std::max(a.y,b.y))});
+	}
+
+	std::sort(segments.begin(),segments.end(),[](auto& s, auto& t){ return s.min_x < t.min_x; });
+
+	auto common_endpoint = [](auto& s, auto& t){
+		return s.u==t.u || s.u==t.v || s.v==t.u || s.v==t.v;
+	};
+
+	std::vector<std::pair<edge_t<Graph>,edge_t<Graph>>> pairs;
+	//the active segments by their y-interval, and a min-heap of their right ends
+	IntervalSet active(ys.size(),segments.size());
+	std::priority_queue<std::pair<double,size_t>,std::vector<std::pair<double,size_t>>,std::greater<>> ends;
+	std::vector<size_t> overlap;
+
+	for(size_t i=0; i<segments.size(); i++){
+		auto& s = segments[i];
+		//drops the segments that end before s starts
+		while(!ends.empty() && ends.top().first < s.min_x){
+			active.erase(ends.top().second);
+			ends.pop();
+		}
+
+		overlap.clear();
+		active.overlapping(s.min_y,s.max_y,[&overlap](size_t j){ overlap.push_back(j); });
+		for(auto&& j : overlap){
+			auto& t = segments[j];
+			if(common_endpoint(s,t))
+				continue;
+			if(intersect(g.coordinates[s.u],g.coordinates[s.v],g.coordinates[t.u],g.coordinates[t.v])){
+				pairs.push_back({t.e,s.e});
+				if(first_only)
+					return pairs;
+			}
 		}
+		active.insert(i,s.min_y,s.max_y);
+		ends.push({s.max_x,i});
 	}
 
-	return true;
+	return pairs;
+}
+
+/**
+ * Checks if no two non-adjacent edges cross when drawn as straight lines. See crossingPairs.
+ */
+template <typename Graph>
+auto isStraightLineDrawing(const DrawnGraph<Graph>& g) -> bool{
+	return crossingPairs(g,true).empty();
+}
+
+/**
+ * Returns the pairs of non-adjacent edges that cross in the drawing of `index`, testing only its candidate pairs of segments.
+ * If `first_only` is set it stops at the first pair found.
+ */
+template <typename Graph>
+auto crossingPairs(const DrawnGraph<Graph>& g, const SpatialIndex& index, const bool first_only = false) -> std::vector<std::pair<edge_t<Graph>,edge_t<Graph>>>{
+	std::vector<edge_t<Graph>> edges_by_index(g.numEdges());
+	for(auto&& e : g.edges())
+		edges_by_index[g.index(e)] = e;
+
+	std::vector<std::pair<size_t,size_t>> crossing;
+	for(auto&& [i,j] : index.candidatePairs()){
+		auto& s = index.segment(i);
+		auto& t = index.segment(j);
+		if(SpatialIndex::segmentsCross(s,t)){
+			crossing.push_back(std::minmax(s.edge,t.edge));
+			if(first_only)
+				break;
+		}
+	}
+	std::sort(crossing.begin(),crossing.end());
+	crossing.erase(std::unique(crossing.begin(),crossing.end()),crossing.end());
+
+	std::vector<std::pair<edge_t<Graph>,edge_t<Graph>>> pairs;
+	for(auto&& [e,f] : crossing)
+		pairs.push_back({edges_by_index[e],edges_by_index[f]});
+	return pairs;
+}
+
+/**
+ * Checks if no two non-adjacent edges cross in the drawing of `index`.
+ */
+template <typename Graph>
+auto isStraightLineDrawing(const DrawnGraph<Graph>& g, const SpatialIndex& index) -> bool{
+	return crossingPairs(g,index,true).empty();
 }
 
 
@@ -4,10 +4,18 @@
 #include <vector>
 #include <map>
 #include <limits>
+#include <array>
+#include <span>
+#include <bit>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdint>
 
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/undirected_dfs.hpp>
 #include <boost/graph/boyer_myrvold_planar_test.hpp>
+#include <boost/graph/connected_components.hpp>
 
 #include <gdraw/graph_types.hpp>
 #include <gdraw/util.hpp>
@@ -30,12 +38,79 @@ auto is1Sided(const EmbeddedGraph<Graph>& g, const T& cycle) -> bool{
 	return signal == -1? true: false;
 }
 
+/**
+ * Signal of the tree path from a root to each vertex for a fixed spanning forest of an embedded graph.
+ *
+ * Built in a single pass over the tree. With it, the sidedness of the fundamental cycle
+ * of any cotree edge is answered in constant time.
+ */
+template <typename Graph>
+class SignalParityIndex{
+
+	public:
+		const EmbeddedGraph<Graph>& graph;
+		std::vector<int> parity;
+
+		/**
+		 * `tree` is a forest as returned by bfsTree or dfsForest: position i contains the
+		 * edge between vertex i and its parent. Vertices without a parent are roots.
+		 */
+		SignalParityIndex(const EmbeddedGraph<Graph>& graph, const std::vector<std::optional<edge_t<Graph>>>& tree):
+			graph(graph),
+			parity(graph.numVertices(),1){
+
+			std::vector<vertex_t<Graph>> stack;
+
+			for(auto&& r : graph.vertices()){
+				if(tree[graph.index(r)])
+					continue;
+
+				stack.push_back(r);
+				while(!stack.empty()){
+					auto u = stack.back();
+					stack.pop_back();
+
+					for(auto&& e : graph.incidentEdges(u)){
+						auto [a,b] = graph.endpoints(e);
+						auto v = a!=u ? a : b;
+						if(tree[graph.index(v)] == e){
+							parity[graph.index(v)] = parity[graph.index(u)] * graph.signal(e);
+							stack.push_back(v);
+						}
+					}
+				}
+			}
+		}
+
+		/**
+		 * Signal of the tree path between v and its root.
+		 */
+		inline auto signal(vertex_t<Graph> v) const -> int{
+			return parity[graph.index(v)];
+		}
+
+		/**
+		 * Checks whether the fundamental cycle of the cotree edge e is 1-sided.
+		 * Always false for tree edges.
+		 */
+		inline auto is1Sided(edge_t<Graph> e) const -> bool{
+			auto [u,v] = graph.endpoints(e);
+			return signal(u) * signal(v) * graph.signal(e) == -1;
+		}
+};
+
 /**
  * Returns the smallest one-sided cycle. It is done using the fundamental
  * cycle method. See the book Graphs on Surface for a proof of this.
+ *
+ * For a root r and an edge uv, the walk from r to u in a BFS tree, uv and back from v to r has length depth(u) + depth(v) + 1
+ * and is 1-sided when parity(u)·parity(v)·signal(uv) is -1. The smallest such walk over all roots is the smallest 1-sided cycle.
+ * The BFS runs from 64 roots at a time, with a bit per root in the frontier and parity of each vertex, where the parent of a vertex is its first neighbor in the previous level.
+ * Each level checks the edges between the frontier and itself (odd walks) or the next level (even walks), so a batch stops at the first 1-sided walk.
+ * The batches are shared by `threads` threads, and only the winning cycle is built.
  */
 template <typename Graph>
-auto smallest1SidedCycle(const EmbeddedGraph<Graph>& g){
+auto smallest1SidedCycle(const EmbeddedGraph<Graph>& g, size_t threads = 1){
 	
 	using tree_type = decltype(bfsTree(std::declval<IndexedGraph<Graph>>(),
 				std::declval<vertex_t<Graph>>()));
@@ -43,22 +118,122 @@ auto smallest1SidedCycle(const EmbeddedGraph<Graph>& g){
 				std::declval<tree_type>(),
 				std::declval<edge_t<Graph>>())) cycle;
 
-	size_t cycle_size = g.numVertices()+1;
-
-	for(auto&& v : g.vertices()){
-		auto v_bfs_tree = bfsTree(g,v);
-		for(auto&& e : g.edges()){
+	auto n = g.numVertices();
+	auto m = g.numEdges();
+	std::vector<edge_t<Graph>> edges_by_index(m);
+	std::vector<std::array<size_t,2>> ends(m);
+	std::vector<uint64_t> negative(m);
+	//neighbors and edges by index, in the order of incidentEdges
+	std::vector<std::vector<std::pair<size_t,size_t>>> adjacent(n);
+	for(auto&& e : g.edges()){
+		auto [u,v] = g.endpoints(e);
+		auto i = g.index(e);
+		edges_by_index[i] = e;
+		ends[i] = {g.index(u),g.index(v)};
+		negative[i] = g.signal(e) == -1 ? ~(uint64_t)0 : 0;
+	}
+	for(auto&& u : g.vertices())
+		for(auto&& e : g.incidentEdges(u)){
 			auto [a,b] = g.endpoints(e);
-			if(e != v_bfs_tree[a] && e != v_bfs_tree[b]){
-				//e is not a tree edge
-				auto e_cycle = fundamentalCycle(g,v_bfs_tree,e);
-				if(is1Sided(g,e_cycle) && e_cycle.size()<cycle_size){
-					cycle = std::move(e_cycle);
-					cycle_size = cycle.size();
+			adjacent[g.index(u)].push_back({g.index(a!=u ? a : b),g.index(e)});
+		}
+
+	//the walk length, the root and the edge of the best walk, smallest first
+	const size_t none = std::numeric_limits<size_t>::max();
+	using walk_t = std::array<size_t,3>;
+	walk_t best{none,none,none};
+	std::atomic<size_t> bound = none;
+	std::atomic<size_t> next_batch = 0;
+	std::mutex best_mutex;
+
+	auto search = [&](){
+		std::vector<uint64_t> visited(n), frontier(n), found(n), parity(n);
+
+		for(size_t batch = next_batch++; 64*batch < n; batch = next_batch++){
+			auto first = 64*batch;
+			std::fill(visited.begin(),visited.end(),0);
+			std::fill(frontier.begin(),frontier.end(),0);
+			std::fill(parity.begin(),parity.end(),0);
+			for(size_t k=0; k<64 && first+k<n; k++)
+				visited[first+k] = frontier[first+k] = (uint64_t)1 << k;
+
+			walk_t batch_best{none,none,none};
+			auto record = [&](uint64_t roots, size_t length, size_t e){
+				walk_t walk{length,first + std::countr_zero(roots),e};
+				batch_best = std::min(batch_best,walk);
+			};
+
+			for(size_t level=0; 2*level+1 <= bound; level++){
+				bool any = false;
+				for(size_t v=0; v<n; v++){
+					auto remaining = ~visited[v];
+					uint64_t fresh = 0;
+					for(size_t k=0; k<adjacent[v].size() && remaining; k++){
+						auto [u,e] = adjacent[v][k];
+						auto b = frontier[u] & remaining;
+						parity[v] |= (parity[u] ^ negative[e]) & b;
+						remaining &= ~b;
+						fresh |= b;
+					}
+					found[v] = fresh;
+					any = any || fresh;
+				}
+
+				for(size_t e=0; e<m; e++){
+					auto [u,v] = ends[e];
+					auto one_sided = parity[u] ^ parity[v] ^ negative[e];
+					if(auto odd = frontier[u] & frontier[v] & one_sided)
+						record(odd,2*level+1,e);
+					if(auto even = ((frontier[u] & found[v]) | (found[u] & frontier[v])) & one_sided)
+						record(even,2*level+2,e);
+				}
+
+				if(batch_best[0] != none || !any)
+					break;
+				for(size_t v=0; v<n; v++){
+					visited[v] |= found[v];
+					frontier[v] = found[v];
 				}
 			}
+
+			std::lock_guard<std::mutex> lock(best_mutex);
+			best = std::min(best,batch_best);
+			bound = best[0];
 		}
-	}
+	};
+
+	threads = std::max(threads,(size_t)1);
+	std::vector<std::thread> workers;
+	for(size_t t=1; t<threads; t++)
+		workers.emplace_back(search);
+	search();
+	for(auto&& w : workers)
+		w.join();
+
+	auto [length,root,e] = best;
+	if(length == none)
+		return cycle;
+
+	//the BFS tree of the winning root, with the same parents as in the search
+	std::vector<size_t> depth(n,none);
+	std::vector<size_t> queue{root};
+	depth[root] = 0;
+	for(size_t q=0; q<queue.size(); q++)
+		for(auto&& [v,f] : adjacent[queue[q]])
+			if(depth[v] == none){
+				depth[v] = depth[queue[q]] + 1;
+				queue.push_back(v);
+			}
+
+	tree_type tree(n);
+	for(auto&& v : queue)
+		for(auto&& [u,f] : adjacent[v])
+			if(depth[u] + 1 == depth[v]){
+				tree[v] = edges_by_index[f];
+				break;
+			}
+
+	cycle = fundamentalCycle(g,tree,edges_by_index[e]);
 	return cycle;
 }
 
@@ -345,6 +520,7 @@ auto isOrientable(EmbeddedGraph<Graph>& g) -> bool{
 
 /**
  * Returns the facial walk of the face incident with  the u->v side of the edge e.
+ * If `sides` is given, the side 2i+s of each step is appended to it, where s is the side of the edge with index i marked in `visited`.
  */
 template <typename Graph>
 auto facialWalk(const EmbeddedGraph<Graph>& g,
@@ -353,7 +529,8 @@ auto facialWalk(const EmbeddedGraph<Graph>& g,
 		const bool starting_signal,
 	       	const std::vector<std::vector<edge_t<Graph>>>& next_edge,
 	       	const std::vector<std::vector<edge_t<Graph>>>& prev_edge,
-	       	std::vector<std::vector<bool>>& visited
+	       	std::vector<std::vector<bool>>& visited,
+		std::vector<size_t>* sides = nullptr
 		){
 
 	//std::cout << e << ' ' << u << (starting_signal?'+':'-') << std::endl;
@@ -378,31 +555,26 @@ auto facialWalk(const EmbeddedGraph<Graph>& g,
 	//positive edge | negative edge
 	//0: (u,v) u + = (u,v) v - | (u,v) u + = (u,v) v + 
 	//1: (u,v) u - = (u,v) v + | (u,v) u - = (u,v) v -
-	auto mark_visited = [&g,&visited](auto u,auto e,auto positive_signal){
+	auto mark_visited = [&g,&visited](auto u,auto e,auto positive_signal) -> size_t{
 		//std::cout << "m: " << e << ' ' << u << ' ' << (positive_signal?'+':'-') << std::endl;
 		auto [a,b] = g.endpoints(e);
 		auto v = a!=u ? a : b;
 
+		size_t side;
 		if(positive_signal){
 			if(g.index(u) <= g.index(v))
-				visited[g.index(e)][0] = true;
-			else{
-				if(g.signal(e)==1)
-					visited[g.index(e)][1] = true;
-				else
-					visited[g.index(e)][0] = true;
-			}
+				side = 0;
+			else
+				side = g.signal(e)==1 ? 1 : 0;
 		}
 		else{
 			if(g.index(u) <= g.index(v))
-				visited[g.index(e)][1] = true;
-			else{
-				if(g.signal(e)==1)
-					visited[g.index(e)][0] = true;
-				else
-					visited[g.index(e)][1] = true;
-			}
+				side = 1;
+			else
+				side = g.signal(e)==1 ? 0 : 1;
 		}
+		visited[g.index(e)][side] = true;
+		return side;
 	};
 
 	std::vector<edge_t<Graph>> facial_walk;
@@ -412,7 +584,9 @@ auto facialWalk(const EmbeddedGraph<Graph>& g,
 	auto v = u; do{
 		facial_walk.push_back(f);
 		//std::cout << f << ' ' <<  v << ' ' << std::boolalpha << (positive_signal?'+':'-') << std::endl;
-		mark_visited(v,f,positive_signal);
+		auto side = mark_visited(v,f,positive_signal);
+		if(sides)
+			sides->push_back(2*g.index(f) + side);
 
 		if(g.signal(f)==-1)
 			positive_signal = !positive_signal;
@@ -433,9 +607,10 @@ auto facialWalk(const EmbeddedGraph<Graph>& g,
 
 /**
  * Returns all the possible facial walks for an embedded graph g.
+ * If `sides` is given, the sides of the edges (see facialWalk) are appended to it in the order of the walks.
  */
 template <typename Graph>
-auto allFacialWalks(const EmbeddedGraph<Graph>& g){
+auto allFacialWalks(const EmbeddedGraph<Graph>& g, std::vector<size_t>* sides = nullptr){
 	
 	//These are the pi_v(e) and its inverse.
 	std::vector<std::vector<edge_t<Graph>>> next_edge(g.numEdges(),std::vector<edge_t<Graph>>(2));
@@ -484,9 +659,9 @@ auto allFacialWalks(const EmbeddedGraph<Graph>& g){
 		}
 
 		if(!visited[g.index(e)][0])
-			facial_walks.push_back(facialWalk(g,e,u,true,next_edge,prev_edge,visited));
+			facial_walks.push_back(facialWalk(g,e,u,true,next_edge,prev_edge,visited,sides));
 		if(!visited[g.index(e)][1])
-			facial_walks.push_back(facialWalk(g,e,u,false,next_edge,prev_edge,visited));
+			facial_walks.push_back(facialWalk(g,e,u,false,next_edge,prev_edge,visited,sides));
 	}
 
 	return facial_walks;
@@ -494,11 +669,579 @@ auto allFacialWalks(const EmbeddedGraph<Graph>& g){
 }
 
 /**
- * Returns the Euler genus of the graph.
+ * The dual of an embedded graph in compressed form. The vertices are the faces and the dual of the edge with index i joins the faces of its two sides.
+ *
+ * Side 2i+s is the side s of the edge with index i, as marked by facialWalk, and `face(f)` lists the sides of face f in the order of its facial walk.
+ * An edge with both sides on the same face is a loop of the dual.
+ */
+class DualGraph{
+
+	public:
+		DualGraph() = default;
+
+		/**
+		 * Builds the dual from the sides of all the facial walks, concatenated, the length of each walk and whether it starts with a positive signal.
+		 */
+		DualGraph(std::vector<size_t> sides, const std::vector<size_t>& lengths, std::vector<bool> positive):
+		sides(std::move(sides)), positive(std::move(positive)), faces(this->sides.size()/2){
+			begin.reserve(lengths.size());
+			length = lengths;
+			size_t offset = 0;
+			for(size_t f=0; f<lengths.size(); f++){
+				begin.push_back(offset);
+				for(size_t k=offset; k<offset+lengths[f]; k++)
+					faces[this->sides[k]/2][this->sides[k]%2] = f;
+				offset += lengths[f];
+			}
+		}
+
+		auto numFaces() const -> size_t{
+			return begin.size();
+		}
+
+		auto numEdges() const -> size_t{
+			return faces.size();
+		}
+
+		/**
+		 * The sides of face f, in the order of its facial walk.
+		 */
+		auto face(const size_t f) const -> std::span<const size_t>{
+			return {sides.data() + begin[f], length[f]};
+		}
+
+		/**
+		 * Whether the walk of face f starts with a positive signal. With all signals positive, such a walk follows the rotations, and the others go against them.
+		 */
+		auto isPositive(const size_t f) const -> bool{
+			return positive[f];
+		}
+
+		/**
+		 * The faces of the two sides of the edge with index e, that is, the endpoints of its dual edge.
+		 */
+		auto endpoints(const size_t e) const -> const std::array<size_t,2>&{
+			return faces[e];
+		}
+
+		/**
+		 * The face on the other side of the edge of `side`.
+		 */
+		auto across(const size_t side) const -> size_t{
+			return faces[side/2][1 - side%2];
+		}
+
+		/**
+		 * Updates the dual after inserting an edge through face f, from the vertex where the walk of f is at its i-th side to the vertex where it is at its j-th side (i < j).
+		 * The new edge gets the index numEdges(): its side 0 is on f, which keeps the sides i..j-1, and its side 1 is on the new face, which takes the rest of the walk.
+		 * Takes time proportional to the length of f.
+		 *
+		 * @return : The index of the new face.
+		 */
+		auto splitFace(const size_t f, const size_t i, const size_t j) -> size_t{
+			auto e = numEdges();
+			auto g = numFaces();
+			auto b = begin[f];
+			auto k = length[f];
+
+			begin.push_back(sides.size());
+			length.push_back(k - (j-i) + 1);
+			positive.push_back(positive[f]);
+			sides.reserve(sides.size() + length[g]);
+			for(auto t=b+j; t<b+k; t++)
+				sides.push_back(sides[t]);
+			for(auto t=b; t<b+i; t++)
+				sides.push_back(sides[t]);
+			sides.push_back(2*e+1);
+			for(auto t=begin[g]; t<sides.size()-1; t++)
+				faces[sides[t]/2][sides[t]%2] = g;
+
+			//the part left in f fits in its old place
+			std::copy(sides.begin()+b+i,sides.begin()+b+j,sides.begin()+b);
+			sides[b + j-i] = 2*e;
+			length[f] = j-i+1;
+
+			faces.push_back({f,g});
+			return g;
+		}
+
+	private:
+		std::vector<size_t> sides;
+		std::vector<size_t> begin;
+		std::vector<size_t> length;
+		std::vector<bool> positive;
+		std::vector<std::array<size_t,2>> faces;
+};
+
+/**
+ * Returns the dual of an embedded graph, orientable or not, in time linear in its size.
+ */
+template <typename Graph>
+auto dualGraph(const EmbeddedGraph<Graph>& g) -> DualGraph{
+	std::vector<size_t> sides;
+	sides.reserve(2*g.numEdges());
+	auto walks = allFacialWalks(g,&sides);
+
+	//the walks start at the endpoint with the smaller index, so their first side is 0 exactly when the signal is positive
+	std::vector<size_t> lengths;
+	std::vector<bool> positive;
+	lengths.reserve(walks.size());
+	size_t offset = 0;
+	for(auto&& w : walks){
+		lengths.push_back(w.size());
+		positive.push_back(sides[offset]%2 == 0);
+		offset += w.size();
+	}
+
+	return DualGraph(std::move(sides),lengths,std::move(positive));
+}
+
+/**
+ * Returns the Euler genus of the surface the graph is embedded in, i.e. 2c - V + E - F where c is the number of connected components. Each isolated vertex counts as a component with one face.
+ */
+template <typename Graph>
+auto eulerGenus(const EmbeddedGraph<Graph>& g) -> int{
+	std::vector<size_t> component(g.numVertices());
+	int c = boost::connected_components(g.getGraph(),component.data());
+
+	int faces = allFacialWalks(g).size();
+	for(auto&& v : g.vertices())
+		if(g.degree(v)==0)
+			faces++;
+
+	return 2*c - (int)g.numVertices() + (int)g.numEdges() - faces;
+}
+
+
+/**
+ * Z2 homology classes of the closed walks of an embedded graph, from a tree-cotree decomposition.
+ *
+ * A spanning forest T and a spanning forest C of the dual avoiding T leave out some edges L, as many as the Euler genus for a connected graph.
+ * Each edge gets a label in Z2^L, packed in words(): a unit vector on L, zero on T, and on C the sum of the other edges of the face below it in C,
+ * so that every facial walk sums to zero. The class of a closed walk is the XOR of the labels of its edges, and it is zero exactly when the walk separates the surface.
+ * Bit genus() of a label is set when the edge has a negative signal, so the same sum tells whether the walk is 1-sided.
+ * That bit is the parity of the negative signals, the same product the free is1Sided takes; the free one stays for single checks,
+ * since it needs no index, while callers that already hold an index (or ask many queries) use this one.
+ * Building the index takes O(m·g/64) time, and each query is linear in the length of the walk.
+ */
+template <typename Graph>
+class HomologyIndex{
+
+	public:
+		const EmbeddedGraph<Graph>& graph;
+
+		HomologyIndex(const EmbeddedGraph<Graph>& graph): graph(graph){
+			auto n = graph.numVertices();
+			auto m = graph.numEdges();
+			const size_t none = std::numeric_limits<size_t>::max();
+
+			std::vector<std::vector<std::pair<size_t,size_t>>> adjacent(n);
+			for(auto&& u : graph.vertices())
+				for(auto&& e : graph.incidentEdges(u)){
+					auto [a,b] = graph.endpoints(e);
+					adjacent[graph.index(u)].push_back({graph.index(a!=u ? a : b),graph.index(e)});
+				}
+
+			std::vector<bool> in_tree(m,false), in_cotree(m,false), seen(n,false);
+			std::vector<size_t> queue;
+			for(size_t r=0; r<n; r++){
+				if(seen[r])
+					continue;
+				seen[r] = true;
+				queue.assign(1,r);
+				for(size_t q=0; q<queue.size(); q++)
+					for(auto&& [v,e] : adjacent[queue[q]])
+						if(!seen[v]){
+							seen[v] = true;
+							in_tree[e] = true;
+							queue.push_back(v);
+						}
+			}
+
+			//the side of the cotree edge of each face on that face
+			auto dual = dualGraph(graph);
+			std::vector<size_t> face_order, parent_side(dual.numFaces(),none);
+			std::vector<bool> reached(dual.numFaces(),false);
+			for(size_t root=0; root<dual.numFaces(); root++){
+				if(reached[root])
+					continue;
+				reached[root] = true;
+				face_order.push_back(root);
+				for(size_t q=face_order.size()-1; q<face_order.size(); q++)
+					for(auto&& side : dual.face(face_order[q])){
+						auto f = dual.across(side);
+						if(!in_tree[side/2] && !reached[f]){
+							reached[f] = true;
+							in_cotree[side/2] = true;
+							parent_side[f] = side^1;
+							face_order.push_back(f);
+						}
+					}
+			}
+
+			std::vector<size_t> leftover(m,none);
+			for(size_t e=0; e<m; e++)
+				if(!in_tree[e] && !in_cotree[e])
+					leftover[e] = rank++;
+
+			word_count = (rank + 1 + 63)/64;
+			labels.assign(m*word_count,0);
+			for(size_t e=0; e<m; e++)
+				if(leftover[e] != none)
+					labels[e*word_count + leftover[e]/64] = (uint64_t)1 << (leftover[e]%64);
+
+			//from the leaves of the dual forest up
+			for(auto it = face_order.rbegin(); it != face_order.rend(); it++){
+				auto side = parent_side[*it];
+				if(side == none)
+					continue;
+				for(auto&& s : dual.face(*it))
+					if(s != side)
+						for(size_t w=0; w<word_count; w++)
+							labels[(side/2)*word_count + w] ^= labels[(s/2)*word_count + w];
+			}
+
+			for(auto&& e : graph.edges())
+				if(graph.signal(e) == -1)
+					labels[graph.index(e)*word_count + rank/64] |= (uint64_t)1 << (rank%64);
+		}
+
+		/**
+		 * The number of independent classes, i.e. the bits of the labels before the signal bit.
+		 */
+		auto genus() const -> size_t{
+			return rank;
+		}
+
+		auto words() const -> size_t{
+			return word_count;
+		}
+
+		/**
+		 * The label of the edge with index i.
+		 */
+		auto label(const size_t i) const -> std::span<const uint64_t>{
+			return {labels.data() + i*word_count, word_count};
+		}
+
+		auto label(const edge_t<Graph>& e) const -> std::span<const uint64_t>{
+			return label(graph.index(e));
+		}
+
+		/**
+		 * The XOR of the labels of a walk, with its signal bit.
+		 */
+		template <EdgeRange<Graph> T>
+		auto sum(const T& walk) const -> std::vector<uint64_t>{
+			std::vector<uint64_t> total(word_count,0);
+			for(auto&& e : walk){
+				auto l = label(e);
+				for(size_t w=0; w<word_count; w++)
+					total[w] ^= l[w];
+			}
+			return total;
+		}
+
+		/**
+		 * Whether a sum of labels has no homology, ignoring the signal bit.
+		 */
+		auto isNullHomologous(std::span<const uint64_t> total) const -> bool{
+			for(size_t w=0; w<word_count; w++){
+				auto bits = total[w];
+				if(w == rank/64)
+					bits &= ~((uint64_t)1 << (rank%64));
+				if(bits)
+					return false;
+			}
+			return true;
+		}
+
+		/**
+		 * Checks whether a closed walk separates the surface. Contractible walks do.
+		 */
+		template <EdgeRange<Graph> T>
+		auto isNullHomologous(const T& walk) const -> bool{
+			return isNullHomologous(std::span<const uint64_t>(sum(walk)));
+		}
+
+		auto is1Sided(std::span<const uint64_t> total) const -> bool{
+			return (total[rank/64] >> (rank%64)) & 1;
+		}
+
+		/**
+		 * Checks whether a closed walk is 1-sided, as the free is1Sided does, from its sum.
+		 */
+		template <EdgeRange<Graph> T>
+		auto is1Sided(const T& walk) const -> bool{
+			return is1Sided(std::span<const uint64_t>(sum(walk)));
+		}
+
+		/**
+		 * Checks whether two closed walks are in the same class, i.e. together they separate the surface.
+		 */
+		template <EdgeRange<Graph> T, EdgeRange<Graph> U>
+		auto homologous(const T& a, const U& b) const -> bool{
+			auto total = sum(a);
+			auto other = sum(b);
+			for(size_t w=0; w<word_count; w++)
+				total[w] ^= other[w];
+			return isNullHomologous(std::span<const uint64_t>(total));
+		}
+
+	private:
+		size_t rank = 0;
+		size_t word_count = 1;
+		std::vector<uint64_t> labels;
+};
+
+/**
+ * Checks whether the closed curves that separate the surface of `g` are exactly the contractible ones, which holds on the sphere, the projective plane and the torus.
+ * On the Klein bottle and on every surface of Euler genus 3 or more some non-contractible curves separate, so nonseparatingEdgeWidth and nonseparatingFaceWidth
+ * only bound the edge-width and face-width from above.
+ */
+template <typename Graph>
+auto separatingIsContractible(const EmbeddedGraph<Graph>& g) -> bool{
+	auto genus = eulerGenus(g);
+	if(genus != 2)
+		return genus < 2;
+
+	//the torus and not the Klein bottle, i.e. no fundamental cycle is 1-sided
+	auto tree = dfsForest(g,g.vertex(0));
+	SignalParityIndex<Graph> parity(g,tree);
+	for(auto&& e : g.edges())
+		if(parity.is1Sided(e))
+			return false;
+	return true;
+}
+
+/**
+ * Returns a shortest cycle that is not null-homologous over Z2, that is, a shortest nonseparating cycle, with the labels of a HomologyIndex.
+ * As in smallest1SidedCycle, the shortest nonseparating walk from a root along its BFS tree and through one more edge, over all roots, is a shortest nonseparating cycle.
+ * Once a cycle of length l is known, each BFS stops at depth l/2 and only the edges it reached are checked, so this takes O(n·(n+m)·g/64) time in the worst case,
+ * and about n times the size of a ball of radius l/2 on embeddings of small edge-width.
+ *
+ * It is a shortest non-contractible cycle when separatingIsContractible holds.
+ *
+ * @return : The cycle, or nothing if the graph is planar.
+ */
+template <typename Graph>
+auto shortestNonseparatingCycle(const EmbeddedGraph<Graph>& g){
+	using tree_type = decltype(bfsTree(std::declval<IndexedGraph<Graph>>(),
+				std::declval<vertex_t<Graph>>()));
+	decltype(fundamentalCycle(std::declval<IndexedGraph<Graph>>(),
+				std::declval<tree_type>(),
+				std::declval<edge_t<Graph>>())) cycle;
+
+	HomologyIndex<Graph> homology(g);
+	if(homology.genus() == 0)
+		return cycle;
+
+	auto n = g.numVertices();
+	auto m = g.numEdges();
+	auto words = homology.words();
+	const size_t none = std::numeric_limits<size_t>::max();
+	std::vector<edge_t<Graph>> edges_by_index(m);
+	std::vector<std::vector<std::pair<size_t,size_t>>> adjacent(n);
+	for(auto&& e : g.edges())
+		edges_by_index[g.index(e)] = e;
+	for(auto&& u : g.vertices())
+		for(auto&& e : g.incidentEdges(u)){
+			auto [a,b] = g.endpoints(e);
+			adjacent[g.index(u)].push_back({g.index(a!=u ? a : b),g.index(e)});
+		}
+
+	size_t best_length = none, best_root = none, best_edge = none;
+	std::vector<size_t> depth(n,none), parent(n), parent_edge(n), order;
+	auto bfs = [&](size_t root){
+		for(auto&& v : order)
+			depth[v] = none;
+		order.assign(1,root);
+		depth[root] = 0;
+		parent_edge[root] = none;
+		for(size_t q=0; q<order.size(); q++){
+			auto u = order[q];
+			//the two ends of an edge in a BFS are at most one level apart, so a shorter walk has no deeper vertex
+			if(best_length != none && 2*depth[u] + 3 > best_length)
+				break;
+			for(auto&& [v,e] : adjacent[u])
+				if(depth[v] == none){
+					depth[v] = depth[u] + 1;
+					parent[v] = u;
+					parent_edge[v] = e;
+					order.push_back(v);
+				}
+		}
+	};
+
+	//the sum of the labels of the tree path from the root to each vertex
+	std::vector<uint64_t> path(n*words), total(words);
+	for(size_t r=0; r<n; r++){
+		bfs(r);
+		for(auto&& v : order){
+			if(v == r){
+				std::fill(path.begin() + v*words,path.begin() + (v+1)*words,0);
+				continue;
+			}
+			auto l = homology.label(parent_edge[v]);
+			for(size_t w=0; w<words; w++)
+				path[v*words + w] = path[parent[v]*words + w] ^ l[w];
+		}
+
+		for(auto&& a : order)
+			for(auto&& [b,e] : adjacent[a]){
+				if(depth[b] == none || depth[a] + depth[b] + 1 >= best_length)
+					continue;
+				auto l = homology.label(e);
+				for(size_t w=0; w<words; w++)
+					total[w] = path[a*words + w] ^ path[b*words + w] ^ l[w];
+				if(!homology.isNullHomologous(std::span<const uint64_t>(total))){
+					best_length = depth[a] + depth[b] + 1;
+					best_root = r;
+					best_edge = e;
+				}
+			}
+	}
+
+	if(best_root == none)
+		return cycle;
+	best_length = none;
+	bfs(best_root);
+	tree_type tree(n);
+	for(auto&& v : order)
+		if(parent_edge[v] != none)
+			tree[v] = edges_by_index[parent_edge[v]];
+	cycle = fundamentalCycle(g,tree,edges_by_index[best_edge]);
+	return cycle;
+}
+
+/**
+ * The length of shortestNonseparatingCycle, an upper bound on the edge-width that is 0 for planar graphs.
+ */
+template <typename Graph>
+auto nonseparatingEdgeWidth(const EmbeddedGraph<Graph>& g) -> size_t{
+	return shortestNonseparatingCycle(g).size();
+}
+
+/**
+ * The edge-width of an embedding: the length of a shortest non-contractible cycle, or 0 for planar graphs.
+ *
+ * @return : The edge-width, or nothing if separatingIsContractible does not hold, i.e. beyond the projective plane and the torus.
+ */
+template <typename Graph>
+auto edgeWidth(const EmbeddedGraph<Graph>& g) -> std::optional<size_t>{
+	if(!separatingIsContractible(g))
+		return {};
+	return nonseparatingEdgeWidth(g);
+}
+
+/**
+ * The fewest points in which a closed curve that does not separate the surface meets the graph, an upper bound on the face-width that is 0 for planar graphs.
+ * Such a curve can be taken through vertices and faces only, so it is half the length of a shortest nonseparating cycle of the radial graph,
+ * which has a node for each vertex and each face and an edge for each corner of a facial walk.
+ *
+ * The corner where the walk of face f is at its k-th step is labelled with the HomologyIndex sum of the first k edges of the walk.
+ * Passing through f from one corner to another then has the class of the boundary path between them.
+ * As in shortestNonseparatingCycle, the search runs a BFS of the radial graph from each vertex and checks the corners it reached against the tree paths.
+ * The roots are shared by `threads` threads, and the depth of each BFS is bounded by the best curve found so far.
+ * This takes O(n·(n+m)·g/64) time in the worst case, and much less when the face-width is small.
+ */
+template <typename Graph>
+auto nonseparatingFaceWidth(const EmbeddedGraph<Graph>& g, size_t threads = 1) -> size_t{
+	HomologyIndex<Graph> homology(g);
+	if(homology.genus() == 0)
+		return 0;
+
+	auto n = g.numVertices();
+	auto words = homology.words();
+	auto walks = allFacialWalks(g);
+	auto nodes = n + walks.size();
+
+	//the labels of the corners, each an edge between a face node and a vertex
+	std::vector<uint64_t> corner_label;
+	std::vector<std::vector<std::pair<size_t,size_t>>> adjacent(nodes);
+	for(size_t f=0; f<walks.size(); f++){
+		//the walks start at the endpoint with the smaller index
+		auto [a,b] = g.endpoints(walks[f][0]);
+		auto v = g.index(a) <= g.index(b) ? a : b;
+		std::vector<uint64_t> prefix(words,0);
+		for(auto&& e : walks[f]){
+			auto c = corner_label.size()/words;
+			corner_label.insert(corner_label.end(),prefix.begin(),prefix.end());
+			adjacent[n+f].push_back({g.index(v),c});
+			adjacent[g.index(v)].push_back({n+f,c});
+
+			auto l = homology.label(e);
+			for(size_t w=0; w<words; w++)
+				prefix[w] ^= l[w];
+			auto [x,y] = g.endpoints(e);
+			v = x!=v ? x : y;
+		}
+	}
+
+	const size_t none = std::numeric_limits<size_t>::max();
+	std::atomic<size_t> bound = none;
+	std::atomic<size_t> next_root = 0;
+
+	auto search = [&](){
+		std::vector<size_t> depth(nodes,none), order;
+		std::vector<uint64_t> path(nodes*words), total(words);
+
+		for(size_t r = next_root++; r < n; r = next_root++){
+			for(auto&& u : order)
+				depth[u] = none;
+			order.assign(1,r);
+			depth[r] = 0;
+			std::fill(path.begin() + r*words,path.begin() + (r+1)*words,0);
+			for(size_t q=0; q<order.size(); q++){
+				auto u = order[q];
+				//a walk through a deeper node is no shorter than the bound
+				if(2*depth[u] + 2 >= bound)
+					break;
+				for(auto&& [v,c] : adjacent[u])
+					if(depth[v] == none){
+						depth[v] = depth[u] + 1;
+						for(size_t w=0; w<words; w++)
+							path[v*words + w] = path[u*words + w] ^ corner_label[c*words + w];
+						order.push_back(v);
+					}
+			}
+
+			size_t local = none;
+			for(auto&& a : order)
+				for(auto&& [b,c] : adjacent[a]){
+					if(depth[b] == none || depth[a] + depth[b] + 1 >= std::min(local,bound.load()))
+						continue;
+					for(size_t w=0; w<words; w++)
+						total[w] = path[a*words + w] ^ path[b*words + w] ^ corner_label[c*words + w];
+					if(!homology.isNullHomologous(std::span<const uint64_t>(total)))
+						local = depth[a] + depth[b] + 1;
+				}
+
+			for(auto current = bound.load(); local < current && !bound.compare_exchange_weak(current,local); );
+		}
+	};
+
+	threads = std::max(threads,(size_t)1);
+	std::vector<std::thread> workers;
+	for(size_t t=1; t<threads; t++)
+		workers.emplace_back(search);
+	search();
+	for(auto&& w : workers)
+		w.join();
+
+	return bound == none ? 0 : bound/2;
+}
+
+/**
+ * The face-width (representativity) of an embedding: the fewest points in which a non-contractible closed curve meets the graph, or 0 for planar graphs.
+ *
+ * @return : The face-width, or nothing if separatingIsContractible does not hold, i.e. beyond the projective plane and the torus.
  */
 template <typename Graph>
-auto eulerGenus(EmbeddedGraph<Graph>& g) -> int{
-	return 0;
+auto faceWidth(const EmbeddedGraph<Graph>& g, size_t threads = 1) -> std::optional<size_t>{
+	if(!separatingIsContractible(g))
+		return {};
+	return nonseparatingFaceWidth(g,threads);
 }
 
 
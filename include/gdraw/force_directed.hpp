@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <array>
+
+#include <gdraw/graph_types.hpp>
+#include <gdraw/coordinates.hpp>
+#include <gdraw/draw.hpp>
+
+namespace gdraw{
+
+/**
+ * A quadtree over a set of points, where each node keeps the number of points and the center of mass of its square.
+ * Used for the Barnes-Hut approximation of the repulsive forces in forceDirectedDraw.
+ */
+class QuadTree{
+
+	public:
+		QuadTree(const std::vector<coord_t>& points){
+			if(points.empty())
+				return;
+
+			auto min_x = points[0].x, max_x = points[0].x;
+			auto min_y = points[0].y, max_y = points[0].y;
+			for(auto&& p : points){
+				min_x = std::min(min_x,p.x);
+				max_x = std::max(max_x,p.x);
+				min_y = std::min(min_y,p.y);
+				max_y = std::max(max_y,p.y);
+			}
+			auto side = std::max({max_x - min_x, max_y - min_y, 1e-9});
+
+			nodes.push_back(Node{min_x,min_y,side});
+			for(auto&& p : points)
+				insert(0,p,0);
+		}
+
+		/**
+		 * Adds to `force` the repulsion k^2/d of every point on `p`, approximating the squares seen from `p` under an angle smaller than `theta` by their center of mass.
+		 */
+		auto repulsion(const coord_t& p, const double k, const double theta, coord_t& force) const -> void{
+			if(nodes.empty())
+				return;
+			std::vector<size_t> stack{0};
+			while(!stack.empty()){
+				auto& node = nodes[stack.back()];
+				stack.pop_back();
+				if(node.count == 0)
+					continue;
+
+				auto dx = p.x - node.center.x;
+				auto dy = p.y - node.center.y;
+				auto d2 = dx*dx + dy*dy;
+
+				if(node.leaf || node.side*node.side < theta*theta*d2){
+					//the point itself
+					if(d2 < 1e-18)
+						continue;
+					auto f = node.count * k*k / d2;
+					force.x += dx * f;
+					force.y += dy * f;
+				}
+				else
+					for(auto&& c : node.children)
+						if(c != 0)
+							stack.push_back(c);
+			}
+		}
+
+	private:
+		struct Node{
+			double x;
+			double y;
+			double side;
+			size_t count = 0;
+			coord_t center{0,0};
+			bool leaf = true;
+			//0 is the root, so it marks a missing child
+			std::array<size_t,4> children{0,0,0,0};
+		};
+
+		std::vector<Node> nodes;
+
+		static constexpr size_t max_depth = 40;
+
+		auto insert(size_t i, const coord_t& p, size_t depth) -> void{
+			//a leaf with a point is split, unless the points are too close
+			if(nodes[i].leaf && nodes[i].count > 0 && depth < max_depth){
+				nodes[i].leaf = false;
+				auto q = nodes[i].center;
+				push(i,q,depth);
+			}
+
+			auto& node = nodes[i];
+			node.center.x = (node.center.x * node.count + p.x)/(node.count+1);
+			node.center.y = (node.center.y * node.count + p.y)/(node.count+1);
+			node.count++;
+
+			if(!node.leaf)
+				push(i,p,depth);
+		}
+
+		//inserts p in the child of i containing it
+		auto push(size_t i, const coord_t& p, size_t depth) -> void{
+			auto half = nodes[i].side/2;
+			size_t quadrant = (p.x >= nodes[i].x + half ? 1 : 0) + (p.y >= nodes[i].y + half ? 2 : 0);
+			if(nodes[i].children[quadrant] == 0){
+				Node child{nodes[i].x + (quadrant & 1 ? half : 0), nodes[i].y + (quadrant & 2 ? half : 0), half};
+				nodes[i].children[quadrant] = nodes.size();
+				nodes.push_back(child);
+			}
+			insert(nodes[i].children[quadrant],p,depth+1);
+		}
+};
+
+/**
+ * Improves a drawing with the force-directed algorithm of Fruchterman and Reingold. Vertices repel each other with force k^2/d
+ * and edges pull their endpoints with force d^2/k, where k is the ideal edge length for the bounding box of the initial drawing.
+ * The repulsion is approximated with a Barnes-Hut quadtree (exact when `theta` is 0), so each iteration takes O(n log n).
+ * The forces are accumulated by `threads` threads, and the result does not depend on the number of threads.
+ *
+ * The coordinates of `dg` are the initial placement. If they are all equal the vertices start on a circle.
+ * The edges are drawn as straight lines, so `edge_coordinates` is cleared.
+ */
+template <typename Graph>
+auto forceDirectedDraw(DrawnGraph<Graph> dg, const size_t iterations = 300, size_t threads = 1, const double theta = 0.8) -> DrawnGraph<Graph>{
+	auto n = dg.numVertices();
+	auto& position = dg.coordinates;
+	dg.edge_coordinates.clear();
+	if(n < 2)
+		return dg;
+
+	auto min_x = position[0].x, max_x = position[0].x;
+	auto min_y = position[0].y, max_y = position[0].y;
+	for(auto&& p : position){
+		min_x = std::min(min_x,p.x);
+		max_x = std::max(max_x,p.x);
+		min_y = std::min(min_y,p.y);
+		max_y = std::max(max_y,p.y);
+	}
+	auto width = max_x - min_x;
+	auto height = max_y - min_y;
+	if(width <= 0 && height <= 0){
+		position = drawCycle(n);
+		width = height = 2;
+	}
+	width = std::max(width,height/n);
+	height = std::max(height,width/n);
+
+	const double k = std::sqrt(width*height/n);
+	double temperature = std::max(width,height)/10;
+	const double cooling = temperature/(iterations+1);
+
+	std::vector<coord_t> displacement(n);
+	threads = std::max(threads,(size_t)1);
+
+	for(size_t it=0; it<iterations; it++){
+		QuadTree tree(position);
+
+		auto accumulate = [&](size_t begin, size_t end){
+			for(auto i=begin; i<end; i++){
+				auto v = dg.vertex(i);
+				coord_t force{0,0};
+				tree.repulsion(position[i],k,theta,force);
+				for(auto&& u : dg.neighbors(v)){
+					auto dx = position[i].x - position[dg.index(u)].x;
+					auto dy = position[i].y - position[dg.index(u)].y;
+					auto d = std::sqrt(dx*dx + dy*dy);
+					force.x -= dx * d/k;
+					force.y -= dy * d/k;
+				}
+				displacement[i] = force;
+			}
+		};
+
+		std::vector<std::thread> workers;
+		auto chunk = (n + threads - 1)/threads;
+		for(size_t t=1; t<threads && t*chunk < n; t++)
+			workers.emplace_back(accumulate,t*chunk,std::min(n,(t+1)*chunk));
+		accumulate(0,std::min(n,chunk));
+		for(auto&& w : workers)
+			w.join();
+
+		//moves are limited by the temperature
+		for(size_t i=0; i<n; i++){
+			auto d = std::sqrt(displacement[i].x*displacement[i].x + displacement[i].y*displacement[i].y);
+			if(d > 0){
+				auto step = std::min(d,temperature)/d;
+				position[i].x += displacement[i].x * step;
+				position[i].y += displacement[i].y * step;
+			}
+		}
+		temperature -= cooling;
+	}
+
+	return dg;
+}
+
+/**
+ * A draw method for drawFlattenedGraph: a Tutte drawing improved by forceDirectedDraw.
+ */
+template <typename Graph>
+auto forceDirectedPlanarDraw(PlanarGraph<Graph> g) -> DrawnGraph<Graph>{
+	return forceDirectedDraw(tuttePlanarDraw(std::move(g)));
+}
+
+}//namespace
@@ -116,6 +116,30 @@ Graph genV2n(int n) noexcept{
 	return V;
 }
 
+/**
+ * Generates a p by q grid. Vertex i*q+j is in row i and column j.
+ */
+template <typename Graph>
+Graph genGrid(int p,int q) noexcept{
+
+	Graph grid(p*q);
+
+	for (int i=0; i<p;i++)
+		for(int j=0;j<q;j++){
+			if(j+1<q)
+				add_edge(i*q+j,i*q+j+1,grid);
+			if(i+1<p)
+				add_edge(i*q+j,(i+1)*q+j,grid);
+		}
+
+	auto edgei_map = get( boost::edge_index, grid);
+	typename boost::graph_traits<Graph>::edges_size_type ecount = 0;
+
+	for(auto [ei,ei_end] = edges(grid);ei!=ei_end;ei++)
+		put(edgei_map,*ei,ecount++);
+
+	return grid;
+}
 
 /**
  * Generates a complete bipartite graph with parts of size p and q.
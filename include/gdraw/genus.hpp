@@ -0,0 +1,391 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <variant>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+#include <gdraw/graph_types.hpp>
+#include <gdraw/util.hpp>
+
+namespace gdraw{
+
+/**
+ * Branch and bound search for a rotation system of `g` with at most `genus` handles. The graph must not have loops.
+ *
+ * The edges are inserted in BFS order, so that at least one endpoint is already placed, and every
+ * choice of corner at each endpoint is tried. Each edge is split into two darts, 2t and 2t+1 for the t-th inserted edge,
+ * and the faces are kept as labels on the darts. An edge joining two corners of the same face splits it, while an edge joining
+ * corners of two different faces merges them and adds one handle. A branch is cut as soon as the handles
+ * added, plus the ones forced by the maximum number of faces of the final embedding (Euler's formula), exceed `genus`.
+ */
+template <typename Graph>
+class RotationSystemSearch{
+
+	public:
+		struct Choice{
+			int u_dart;
+			int v_dart;
+		};
+
+		RotationSystemSearch(const IndexedGraph<Graph>& g, size_t genus): graph(g), genus(genus){
+			auto n = graph.numVertices();
+
+			//insertion order
+			std::vector<bool> placed(n,false);
+			std::vector<bool> inserted(graph.numEdges(),false);
+			std::vector<size_t> component_edges;
+			bool simple = true;
+			std::vector<size_t> last_neighbor(n,n);
+
+			for(auto&& root : graph.vertices()){
+				if(placed[graph.index(root)] || graph.degree(root)==0)
+					continue;
+				auto c = component_edges.size();
+				component_edges.push_back(0);
+				std::vector<vertex_t<Graph>> queue{root};
+				placed[graph.index(root)] = true;
+				for(size_t i=0; i<queue.size(); i++){
+					auto u = queue[i];
+					for(auto&& e : graph.incidentEdges(u)){
+						auto [a,b] = graph.endpoints(e);
+						auto v = a!=u ? a : b;
+						if(v==u || last_neighbor[graph.index(v)] == graph.index(u))
+							simple = false;
+						last_neighbor[graph.index(v)] = graph.index(u);
+						if(inserted[graph.index(e)])
+							continue;
+						inserted[graph.index(e)] = true;
+						order.push_back(e);
+						u_end.push_back(graph.index(u));
+						v_end.push_back(graph.index(v));
+						closes.push_back(placed[graph.index(v)]);
+						component_edges[c]++;
+						if(!placed[graph.index(v)]){
+							placed[graph.index(v)] = true;
+							queue.push_back(v);
+						}
+					}
+				}
+			}
+
+			auto m = order.size();
+
+			//a connected simple graph with at least 2 edges has faces of length >= 3
+			max_splits = 0;
+			for(auto&& mc : component_edges)
+				max_splits += (mc == 1 ? 1 : simple ? 2*mc/3 : 2*mc) - 1;
+
+			remaining_closing.resize(m+1,0);
+			for(size_t t=m; t-- > 0;)
+				remaining_closing[t] = remaining_closing[t+1] + (closes[t]?1:0);
+
+			//The mirror image of a rotation system has the same genus, so only one
+			//of the two orders of the first vertex with 3 edges is tried
+			mirror_step = m;
+			std::vector<size_t> deg(n,0);
+			for(size_t t=0; t<m && mirror_step==m; t++){
+				if(deg[u_end[t]] == 2 || deg[v_end[t]] == 2){
+					mirror_step = t;
+					mirror_at_u = deg[u_end[t]] == 2;
+				}
+				deg[u_end[t]]++;
+				deg[v_end[t]]++;
+			}
+
+			rho.resize(2*m);
+			rho_inv.resize(2*m);
+			face.resize(2*m);
+			first_dart.resize(n,-1);
+		}
+
+		/**
+		 * Lower bound on the number of handles of any embedding extending the current one.
+		 */
+		auto handlesBound(size_t t) const -> size_t{
+			//a merge removes a face, so each merge allows one more split
+			auto slack = max_splits + merges - splits;
+			auto r = remaining_closing[t];
+			auto forced = r > slack ? (r - slack + 1)/2 : 0;
+			return merges + forced;
+		}
+
+		/**
+		 * All the choices of corners for the t-th edge. Choices that exceed the genus bound are not included.
+		 */
+		auto choices(size_t t) -> std::vector<Choice>{
+			std::vector<Choice> result;
+			auto u_darts = darts(u_end[t]);
+			auto v_darts = darts(v_end[t]);
+			if(t == mirror_step)
+				(mirror_at_u ? u_darts : v_darts).resize(1);
+			for(auto&& a : u_darts)
+				for(auto&& b : v_darts){
+					insert(t,{a,b});
+					if(handlesBound(t+1) <= genus)
+						result.push_back({a,b});
+					remove(t);
+				}
+			return result;
+		}
+
+		auto insert(size_t t, Choice c) -> void{
+			int x = 2*t;
+			int y = 2*t+1;
+			link(x,u_end[t],c.u_dart);
+			link(y,v_end[t],c.v_dart);
+			steps.push_back({log.size(),0});
+
+			if(c.u_dart == -1){
+				//first edge of a component
+				face[x] = face[y] = face_count++;
+				steps.back().kind = 3;
+				return;
+			}
+			if(c.v_dart == -1){
+				face[x] = face[y] = face[c.u_dart^1];
+				return;
+			}
+			auto f1 = face[c.u_dart^1];
+			auto f2 = face[c.v_dart^1];
+			face[x] = face[y] = -1;
+			if(f1 == f2){
+				relabel(x,face_count++);
+				face[y] = f1;
+				splits++;
+				steps.back().kind = 1;
+			}
+			else{
+				relabel(x,f1);
+				merges++;
+				steps.back().kind = 2;
+			}
+		}
+
+		auto remove(size_t t) -> void{
+			auto [log_start,kind] = steps.back();
+			steps.pop_back();
+			while(log.size() > log_start){
+				auto [d,f] = log.back();
+				face[d] = f;
+				log.pop_back();
+			}
+			if(kind == 1)
+				splits--;
+			if(kind == 2)
+				merges--;
+			//face ids are reused
+			if(kind == 1 || kind == 3)
+				face_count--;
+			unlink(2*t+1,v_end[t]);
+			unlink(2*t,u_end[t]);
+		}
+
+		/**
+		 * Depth first search from the t-th edge on. Returns true if an embedding was found.
+		 */
+		auto search(size_t t, const std::atomic<bool>& stop) -> bool{
+			if(t == order.size())
+				return true;
+			if(stop)
+				return false;
+			for(auto&& c : choices(t)){
+				insert(t,c);
+				if(search(t+1,stop))
+					return true;
+				remove(t);
+			}
+			return false;
+		}
+
+		/**
+		 * Enumerates the sequences of choices for the first `depth` edges.
+		 */
+		auto prefixes(size_t depth) -> std::vector<std::vector<Choice>>{
+			std::vector<std::vector<Choice>> result;
+			std::vector<Choice> prefix;
+			auto collect = [&](auto&& self, size_t t) -> void{
+				if(t == depth){
+					result.push_back(prefix);
+					return;
+				}
+				for(auto&& c : choices(t)){
+					insert(t,c);
+					prefix.push_back(c);
+					self(self,t+1);
+					prefix.pop_back();
+					remove(t);
+				}
+			};
+			collect(collect,0);
+			return result;
+		}
+
+		auto numSteps() const{
+			return order.size();
+		}
+
+		auto rotations() const -> rotations_t<Graph>{
+			rotations_t<Graph> result(graph.numVertices());
+			for(size_t v=0; v<result.size(); v++){
+				auto d = first_dart[v];
+				if(d == -1)
+					continue;
+				do{
+					result[v].push_back(order[d/2]);
+					d = rho[d];
+				}while(d != first_dart[v]);
+			}
+			return result;
+		}
+
+	private:
+		const IndexedGraph<Graph>& graph;
+		size_t genus;
+
+		std::vector<edge_t<Graph>> order;
+		std::vector<size_t> u_end;
+		std::vector<size_t> v_end;
+		std::vector<bool> closes;
+		std::vector<size_t> remaining_closing;
+		size_t max_splits;
+		size_t mirror_step;
+		bool mirror_at_u = true;
+
+		std::vector<int> rho;
+		std::vector<int> rho_inv;
+		std::vector<int> face;
+		std::vector<int> first_dart;
+
+		int face_count = 0;
+		size_t merges = 0;
+		size_t splits = 0;
+
+		//kind: 0 - new vertex, 1 - split, 2 - merge, 3 - new component
+		struct Step{
+			size_t log_start;
+			int kind;
+		};
+		std::vector<Step> steps;
+		std::vector<std::pair<int,int>> log;
+
+		auto darts(size_t v) const -> std::vector<int>{
+			std::vector<int> result;
+			auto d = first_dart[v];
+			if(d == -1)
+				return {-1};
+			do{
+				result.push_back(d);
+				d = rho[d];
+			}while(d != first_dart[v]);
+			return result;
+		}
+
+		//inserts dart x right after dart a in the rotation of v
+		auto link(int x, size_t v, int a) -> void{
+			if(a == -1){
+				rho[x] = rho_inv[x] = x;
+				first_dart[v] = x;
+				return;
+			}
+			rho[x] = rho[a];
+			rho_inv[x] = a;
+			rho_inv[rho[a]] = x;
+			rho[a] = x;
+		}
+
+		auto unlink(int x, size_t v) -> void{
+			if(rho[x] == x){
+				first_dart[v] = -1;
+				return;
+			}
+			rho[rho_inv[x]] = rho[x];
+			rho_inv[rho[x]] = rho_inv[x];
+			if(first_dart[v] == x)
+				first_dart[v] = rho[x];
+		}
+
+		//labels the face containing dart d
+		auto relabel(int d, int f) -> void{
+			auto e = d;
+			do{
+				log.push_back({e,face[e]});
+				face[e] = f;
+				e = rho[e^1];
+			}while(e != d);
+		}
+};
+
+/**
+ * Searches for an embedding of `g` in the orientable surface of Euler genus `EulerGenus` (i.e. with `EulerGenus/2` handles) with a branch and bound search on its rotation systems, see RotationSystemSearch.
+ * The search is split among `threads` threads. The embedding found may have smaller genus.
+ *
+ * @return : A `std::variant` containing either the graph with an embedding (`OrientableEmbeddedGraph`) or a `NonEmbeddableGraph`. The search is exhaustive, so the forbidden subgraph is the whole graph.
+ */
+template <int EulerGenus, typename Graph>
+auto orientableEmbedding(IndexedGraph<Graph> g, size_t threads = 1) -> std::variant<OrientableEmbeddedGraph<Graph,EulerGenus>,NonEmbeddableGraph<Graph>>{
+	static_assert(EulerGenus % 2 == 0, "Orientable surfaces have even Euler genus");
+
+	RotationSystemSearch<Graph> root(g,EulerGenus/2);
+	std::atomic<bool> found = false;
+	std::optional<rotations_t<Graph>> rotations;
+
+	threads = std::max(threads,(size_t)1);
+	if(threads == 1){
+		if(root.search(0,found))
+			rotations = root.rotations();
+	}
+	else{
+		//enough prefixes to keep every thread busy
+		std::vector<std::vector<typename RotationSystemSearch<Graph>::Choice>> prefixes{{}};
+		for(size_t depth=1; !prefixes.empty() && prefixes.size() < 8*threads && depth <= root.numSteps(); depth++)
+			prefixes = root.prefixes(depth);
+
+		std::atomic<size_t> next = 0;
+		std::mutex result_mutex;
+		auto worker = [&](){
+			RotationSystemSearch<Graph> s(g,EulerGenus/2);
+			for(auto i = next++; i < prefixes.size() && !found; i = next++){
+				for(size_t t=0; t < prefixes[i].size(); t++)
+					s.insert(t,prefixes[i][t]);
+				if(s.search(prefixes[i].size(),found)){
+					std::lock_guard<std::mutex> lock(result_mutex);
+					if(!rotations){
+						rotations = s.rotations();
+						found = true;
+					}
+					return;
+				}
+				for(auto t=prefixes[i].size(); t-- > 0;)
+					s.remove(t);
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for(size_t i=0; i<threads; i++)
+			workers.emplace_back(worker);
+		for(auto&& t : workers)
+			t.join();
+	}
+
+	if(rotations){
+		std::vector<int> edge_signals(g.numEdges(),1);
+		return OrientableEmbeddedGraph<Graph,EulerGenus>(std::move(g),std::move(rotations.value()),std::move(edge_signals));
+	}
+
+	auto forbidden = std::vector<edge_t<Graph>>(g.edges().begin(),g.edges().end());
+	return NonEmbeddableGraph<Graph>(std::move(g),std::move(forbidden));
+}
+
+/**
+ * Searches for an embedding of `g` in the torus. See orientableEmbedding.
+ */
+template <typename Graph>
+auto torusEmbedding(IndexedGraph<Graph> g, size_t threads = 1) -> std::variant<ToroidalGraph<Graph>,NonEmbeddableGraph<Graph>>{
+	return orientableEmbedding<2>(std::move(g),threads);
+}
+
+}//namespace
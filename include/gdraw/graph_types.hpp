@@ -2,6 +2,12 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <optional>
+#include <limits>
+#include <string>
+#include <cstdint>
+#include <algorithm>
 #include <ranges>
 #include <memory>
 #include <iostream>
@@ -96,6 +102,88 @@ auto inline filterOptional(const T<std::optional<U>>& collection){
 		std::views::transform([](auto e){return e.value();});
 }
 
+/**
+ * A map from indices (e.g. edge indices) to values, stored in a flat vector with a presence bitmap.
+ * Lookups are O(1) and copies are plain vector copies. The vectors grow as needed when a value is set.
+ */
+template <typename T>
+class IndexMap{
+
+	public:
+		IndexMap(size_t n = 0): values(n), present(n,false){}
+
+		auto contains(size_t i) const -> bool{
+			return i < present.size() && present[i];
+		}
+
+		auto at(size_t i) const -> const T&{
+			return values[i];
+		}
+
+		auto set(size_t i, T value) -> void{
+			if(i >= values.size()){
+				values.resize(i+1);
+				present.resize(i+1,false);
+			}
+			values[i] = std::move(value);
+			if(!present[i]){
+				present[i] = true;
+				count++;
+			}
+		}
+
+		auto erase(size_t i) -> void{
+			if(contains(i)){
+				present[i] = false;
+				count--;
+			}
+		}
+
+		/**
+		 * Moves the value at `from`, if any, to `to`. The previous value at `to` is lost.
+		 */
+		auto move(size_t from, size_t to) -> void{
+			if(from == to)
+				return;
+			if(contains(from)){
+				set(to,std::move(values[from]));
+				erase(from);
+			}
+			else
+				erase(to);
+		}
+
+		auto clear() -> void{
+			std::fill(present.begin(),present.end(),false);
+			count = 0;
+		}
+
+		auto size() const -> size_t{
+			return count;
+		}
+
+		auto empty() const -> bool{
+			return count == 0;
+		}
+
+		/**
+		 * The indices with a value, in increasing order.
+		 */
+		auto indices() const -> std::vector<size_t>{
+			std::vector<size_t> result;
+			result.reserve(count);
+			for(size_t i=0; i<present.size(); i++)
+				if(present[i])
+					result.push_back(i);
+			return result;
+		}
+
+	private:
+		std::vector<T> values;
+		std::vector<bool> present;
+		size_t count = 0;
+};
+
 /**
  * This class wraps a boost graph class and implements move semantics using std::unique_ptr.
  *
@@ -695,80 +783,69 @@ class NonEmbeddableGraph : public IndexedGraph<Graph>{
 /**
  * A graph drawn on the plane.
  *
- * Edges are drawn as cubic splines and are stored on `edge_coordinates`. Edges whose coordinates are not include there should be interpreted as a line segment between its endpoints.
+ * Edges are drawn as cubic splines and are stored on `edge_coordinates`, by edge index. Edges whose coordinates are not included there should be interpreted as a line segment between its endpoints.
+ * Colors are interned in `palette` and vertices and edges keep their palette ids, where 0 is no color. The palette holds at most 65536 colors, the ids of color_t.
  */
 template <typename Graph>
 class DrawnGraph : public IndexedGraph<Graph>{
 
 	public:
+		using color_t = uint16_t;
+
 		std::vector<coord_t> coordinates;
-		std::vector<std::string> vertex_colors;
-		std::map<edge_t<Graph>,cubicSpline> edge_coordinates;
-		std::map<edge_t<Graph>,std::string> edge_colors;
+		IndexMap<cubicSpline> edge_coordinates;
+		std::vector<std::string> palette{""};
+		std::vector<color_t> vertex_colors;
+		std::vector<color_t> edge_colors;
 
-		DrawnGraph(IndexedGraph<Graph> g, std::vector<coord_t> coordinates):
+		DrawnGraph(IndexedGraph<Graph> g, std::vector<coord_t> coordinates, IndexMap<cubicSpline> edge_coordinates = {}):
 			IndexedGraph<Graph>(std::move(g)),
 			coordinates(std::move(coordinates)),
-       			vertex_colors(num_vertices((*this).getGraph()),""){
-				//std::cout << "Constructor DrawnGraph" << std::endl;
-				//std::cout << "Size: " << vertex_colors.size() << std::endl;
-				//std::cout << "Num_vertices: " << num_vertices(this->getGraph()) << std::endl;
+			edge_coordinates(std::move(edge_coordinates)),
+			vertex_colors(this->numVertices(),0),
+			edge_colors(this->numEdges(),0){}
+
+		DrawnGraph(IndexedGraph<Graph> g, std::vector<coord_t> coordinates, const std::map<edge_t<Graph>,cubicSpline>& splines):
+			DrawnGraph(std::move(g),std::move(coordinates)){
+				for(auto&& [e,s] : splines)
+					edge_coordinates.set(this->index(e),s);
 			}
 
-		DrawnGraph(IndexedGraph<Graph> g, std::vector<coord_t> coordinates,std::map<edge_t<Graph>,cubicSpline> edge_coordinates):
-			IndexedGraph<Graph>(std::move(g)),
-			coordinates(std::move(coordinates)),
-       			vertex_colors(num_vertices((*this).getGraph()),""),
-			edge_coordinates(std::move(edge_coordinates)){}
-
 		DrawnGraph(DrawnGraph&& other):
 		       	IndexedGraph<Graph>(std::move(other)),
-       			vertex_colors(std::move(other.vertex_colors)),
+			coordinates(std::move(other.coordinates)),
 			edge_coordinates(std::move(other.edge_coordinates)),
-			edge_colors(std::move(other.edge_colors)){
+			palette(std::move(other.palette)),
+			vertex_colors(std::move(other.vertex_colors)),
+			edge_colors(std::move(other.edge_colors)),
+			palette_ids(std::move(other.palette_ids)){
 				if constexpr(debug)
 					std::cout << "DrawnGraph Move constructor" << std::endl;
 			}
 
-		DrawnGraph(const DrawnGraph& other) : IndexedGraph<Graph>(other){
-			if constexpr(debug)
-				std::cout << "DrawnGraph Copy constructor" << std::endl;
-			coordinates = other.coordinates;
-			vertex_colors = other.vertex_colors;
-
-			auto this_edgei_map = get(boost::edge_index, (*this).getGraph());
-			auto other_edgei_map = get(boost::edge_index, other.getGraph());
-
-			std::vector<edge_t<Graph>> edges_by_index(num_edges((*this).getGraph()));
-
-			//TODO where is edges defined?
-			for(auto e : range(edges((*this).getGraph()))){
-				auto ei = boost::get(this_edgei_map,e);
-				edges_by_index[ei] = e;
-			}
-
-			for(auto&& [e,s] : other.edge_coordinates){
-				auto ei = boost::get(other_edgei_map,e);
-				auto f = edges_by_index[ei];
-				std::cout << '[' << ei << ']' << e << ' ' << f << ' ' << s << std::endl;
-				(*this).edge_coordinates[f] = s;
-			}
-
-			for(auto&& [e,c] : other.edge_colors){
-				auto ei = boost::get(other_edgei_map,e);
-				auto f = edges_by_index[ei];
-				(*this).edge_colors[f] = c;
+		//the edge indices are copied with the graph, so the attributes are copied as they are
+		DrawnGraph(const DrawnGraph& other):
+			IndexedGraph<Graph>(other),
+			coordinates(other.coordinates),
+			edge_coordinates(other.edge_coordinates),
+			palette(other.palette),
+			vertex_colors(other.vertex_colors),
+			edge_colors(other.edge_colors),
+			palette_ids(other.palette_ids){
+				if constexpr(debug)
+					std::cout << "DrawnGraph Copy constructor" << std::endl;
 			}
-		}
 
 		DrawnGraph& operator=(DrawnGraph&& other){
 			if constexpr(debug)
 				std::cout << "DrawnGraph Move =" << std::endl;
 			IndexedGraph<Graph>::operator=(std::move(other));
-			(*this).edge_colors = std::move(other.edge_colors);
+			(*this).coordinates = std::move(other.coordinates);
 			(*this).edge_coordinates = std::move(other.edge_coordinates);
+			(*this).palette = std::move(other.palette);
 			(*this).vertex_colors = std::move(other.vertex_colors);
-			(*this).coordinates = std::move(other.coordinates);
+			(*this).edge_colors = std::move(other.edge_colors);
+			(*this).palette_ids = std::move(other.palette_ids);
 			return *this;
 		}
 
@@ -779,15 +856,76 @@ class DrawnGraph : public IndexedGraph<Graph>{
 			return *this;
 		}
 
-		auto colorEdge(const edge_t<Graph>& e,std::string color){
-			edge_colors[e] = std::move(color);
-
+		/**
+		 * Returns the palette id of `color`, adding it to the palette if needed, or nothing if the palette is full.
+		 */
+		auto colorId(const std::string& color) -> std::optional<color_t>{
+			if(auto it = palette_ids.find(color); it != palette_ids.end())
+				return it->second;
+			if(palette.size() > std::numeric_limits<color_t>::max())
+				return {};
+			palette_ids[color] = palette.size();
+			palette.push_back(color);
+			return palette.size()-1;
+		}
+
+		/**
+		 * Colors `e`, unless `color` is new and the palette is full.
+		 */
+		auto colorEdge(const edge_t<Graph>& e, const std::string& color) -> bool{
+			auto id = colorId(color);
+			if(!id)
+				return false;
+			size_t i = this->index(e);
+			if(i >= edge_colors.size())
+				edge_colors.resize(i+1,0);
+			edge_colors[i] = id.value();
+			return true;
+		}
+
+		auto colorVertex(const vertex_t<Graph>& v, const std::string& color) -> bool{
+			auto id = colorId(color);
+			if(!id)
+				return false;
+			size_t i = this->index(v);
+			if(i >= vertex_colors.size())
+				vertex_colors.resize(i+1,0);
+			vertex_colors[i] = id.value();
+			return true;
+		}
+
+		/**
+		 * The color of `e`, or "" if it has none.
+		 */
+		auto edgeColor(const edge_t<Graph>& e) const -> const std::string&{
+			size_t i = this->index(e);
+			return palette[i < edge_colors.size() ? edge_colors[i] : 0];
+		}
+
+		auto vertexColor(const vertex_t<Graph>& v) const -> const std::string&{
+			size_t i = this->index(v);
+			return palette[i < vertex_colors.size() ? vertex_colors[i] : 0];
+		}
+
+		/**
+		 * Moves the spline and color of the edge with index `from` to the index `to`, as when EdgeList reuses the index of a removed edge.
+		 * The attributes of the edge at `to` are dropped first, so when `from` and `to` are the same the edge is left without any.
+		 */
+		auto moveEdgeAttributes(size_t from, size_t to) -> void{
+			edge_coordinates.erase(to);
+			if(to < edge_colors.size())
+				edge_colors[to] = 0;
+			if(from == to)
+				return;
+			edge_coordinates.move(from,to);
+			if(std::max(from,to) >= edge_colors.size())
+				edge_colors.resize(std::max(from,to)+1,0);
+			edge_colors[to] = edge_colors[from];
+			edge_colors[from] = 0;
 		}
 
-		auto colorVertex(const vertex_t<Graph>& v, std::string color){
-			//TODO maybe change this to explicitly use vertex_index map
-			vertex_colors[v] = std::move(color);
-		}
+	private:
+		std::unordered_map<std::string,color_t> palette_ids{{"",0}};
 };
 
 template <typename Graph>
@@ -796,6 +934,9 @@ using PlanarGraph = OrientableEmbeddedGraph<Graph,0>;
 template <typename Graph>
 using NonPlanarGraph = NonEmbeddableGraph<Graph>;
 
+template <typename Graph>
+using ToroidalGraph = OrientableEmbeddedGraph<Graph,2>;
+
 template <typename Graph>
 using ProjectivePlanarGraph = NonOrientableEmbeddedGraph<Graph,2>;
 
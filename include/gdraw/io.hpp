@@ -83,17 +83,17 @@ void writeDOT(const DrawnGraph<Graph>& g, std::ostream& out=std::cout){
 		out << "pos=\"" << g.coordinates[v] << "\"";
 	};
 	auto edge_pos_writer = [&g](auto&& out,auto&& e){
-		if(g.edge_coordinates.contains(e))
-			out << "pos=\"" << g.edge_coordinates.at(e) << "\"";
+		if(g.edge_coordinates.contains(g.index(e)))
+			out << "pos=\"" << g.edge_coordinates.at(g.index(e)) << "\"";
 	};
 	auto edge_color_writer = [&g](auto&& out,auto&& e){
-		if(g.edge_colors.contains(e)){
-			out << "color=" << g.edge_colors.at(e);
+		if(auto& color = g.edgeColor(e); color != ""){
+			out << "color=" << color;
 		}
 	};
 	auto vertex_color_writer = [&g](auto&& out,auto&& v){
-		if(!g.vertex_colors.empty() && g.vertex_colors[v]!=""){
-			out << "color=" << g.vertex_colors[v];
+		if(auto& color = g.vertexColor(v); color != ""){
+			out << "color=" << color;
 		}
 	};
 	auto vertex_writer = [&vertex_pos_writer,&vertex_color_writer](auto&& out,auto&& v){
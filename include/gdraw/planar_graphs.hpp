@@ -3,59 +3,184 @@
  */
 #pragma once
 
+#include <vector>
+#include <numeric>
+#include <optional>
+#include <limits>
+#include <span>
+#include <unordered_set>
+
 #include <boost/graph/boyer_myrvold_planar_test.hpp>
 #include <boost/graph/planar_face_traversal.hpp>
-#include <boost/graph/make_biconnected_planar.hpp>
-#include <boost/graph/make_maximal_planar.hpp>
 
 #include <gdraw/graph_types.hpp>
 
 namespace gdraw{
 
 /**
- * Add edges to make `g` maximal planar, that is, all faces are triangles.
+ * Add edges to make `g` maximal planar, that is, all faces are triangles. The graph must be simple.
+ *
+ * The rotations are kept as linked lists of darts, and each face is walked once and triangulated by cutting ears:
+ * a corner b between a and c is cut with a new edge a-c when a and c are distinct and not adjacent, which is checked in a hash set.
+ * Cutting an ear only changes the neighbors of two corners on the face, so each face of length k takes O(k) expected time.
+ * Disconnected graphs are first connected through their lowest vertices. New edges get the next free indices and signal 1.
  */	
 template <typename Graph,int Genus>
 auto makeMaximal(OrientableEmbeddedGraph<Graph,Genus> g) -> OrientableEmbeddedGraph<Graph,Genus>{
-	auto edgei_map = get(boost::edge_index, g.getGraph());
-	auto ecount = num_edges(g.getGraph());
-
-	edge_t<Graph> original_0_edge;
-	for(auto&& e : range(edges(g.getGraph())))
-		if(get(edgei_map,e)==0)
-			original_0_edge = e;
-
-	auto rotations_pmap = make_iterator_property_map(g.rotations.begin(),get(boost::vertex_index,g.getGraph()));
-	make_biconnected_planar(g.getGraph(),rotations_pmap);
+	auto n = g.numVertices();
+	if(n < 3)
+		return g;
+
+	size_t ecount = g.numEdges();
+	std::vector<edge_t<Graph>> edges_by_index(ecount);
+	for(auto&& e : g.edges())
+		edges_by_index[g.index(e)] = e;
+
+	//the dart 2i leaves the source of the edge with index i, and 2i+1 its target
+	std::vector<size_t> tail(2*ecount), succ(2*ecount), pred(2*ecount);
+	const size_t none = std::numeric_limits<size_t>::max();
+	std::vector<size_t> first_dart(n,none);
+	for(size_t i=0; i<ecount; i++){
+		auto [u,v] = g.endpoints(edges_by_index[i]);
+		tail[2*i] = g.index(u);
+		tail[2*i+1] = g.index(v);
+	}
+	for(size_t v=0; v<n; v++){
+		auto& pi_v = g.rotations[v];
+		auto dart = [&](auto&& e){ auto i = g.index(e); return tail[2*i] == v ? 2*i : 2*i+1; };
+		for(size_t j=0; j<pi_v.size(); j++){
+			auto d = dart(pi_v[j]);
+			succ[d] = dart(pi_v[(j+1)%pi_v.size()]);
+			pred[succ[d]] = d;
+		}
+		if(!pi_v.empty())
+			first_dart[v] = dart(pi_v[0]);
+	}
 
-	//Added edges have index 0, we need to fix those for the planarity algorithm
-	auto has_index_0 = [&,original_0_edge,edgei_map](auto&& e){
-		return (e != original_0_edge) && (get(edgei_map,e)==0);
+	std::unordered_set<size_t> adjacent;
+	adjacent.reserve(2*(3*n));
+	auto key = [n](size_t u, size_t v){ return std::min(u,v)*n + std::max(u,v); };
+	for(size_t i=0; i<ecount; i++)
+		adjacent.insert(key(tail[2*i],tail[2*i+1]));
+
+	//adds the edge u-v, with its dart at u right after du and its dart at v right before dv
+	auto addEdge = [&](size_t u, std::optional<size_t> du, size_t v, std::optional<size_t> dv) -> size_t{
+		auto e = g.addEdge(g.vertex(u),g.vertex(v),ecount);
+		edges_by_index.push_back(e);
+		auto [s,t] = g.endpoints(e);
+		auto x = 2*ecount + (g.index(s) == u ? 0 : 1);
+		ecount++;
+		tail.resize(2*ecount);
+		succ.resize(2*ecount);
+		pred.resize(2*ecount);
+		tail[x] = u;
+		tail[x^1] = v;
+		auto link = [&](size_t d, std::optional<size_t> after){
+			if(!after){
+				succ[d] = pred[d] = d;
+				first_dart[tail[d]] = d;
+				return;
+			}
+			succ[d] = succ[*after];
+			pred[d] = *after;
+			pred[succ[d]] = d;
+			succ[*after] = d;
+		};
+		link(x,du);
+		link(x^1,dv ? std::optional<size_t>(pred[*dv]) : std::nullopt);
+		adjacent.insert(key(u,v));
+		return x;
 	};
 
-	for(auto&& e : range(edges(g.getGraph())) | std::views::filter(has_index_0))
-		put(edgei_map,e,ecount++);
-
-	boyer_myrvold_planarity_test(
-		boost::boyer_myrvold_params::graph = g.getGraph()
-		,boost::boyer_myrvold_params::embedding = rotations_pmap
-		);
+	//connects the components
+	{
+		std::vector<bool> reached(n,false);
+		for(size_t root=0; root<n; root++){
+			if(reached[root])
+				continue;
+			if(root > 0){
+				auto at_0 = first_dart[0] != none ? std::optional<size_t>(first_dart[0]) : std::nullopt;
+				auto at_root = first_dart[root] != none ? std::optional<size_t>(first_dart[root]) : std::nullopt;
+				addEdge(0,at_0,root,at_root);
+			}
+			std::vector<size_t> stack{root};
+			reached[root] = true;
+			while(!stack.empty()){
+				auto v = stack.back();
+				stack.pop_back();
+				if(first_dart[v] == none)
+					continue;
+				auto d = first_dart[v];
+				do{
+					auto w = tail[d^1];
+					if(!reached[w]){
+						reached[w] = true;
+						stack.push_back(w);
+					}
+					d = succ[d];
+				}while(d != first_dart[v]);
+			}
+		}
+	}
 
-	make_maximal_planar(g.getGraph(),rotations_pmap);
+	//walks each face and cuts its ears
+	std::vector<bool> visited(succ.size(),false);
+	auto original_darts = succ.size();
+	for(size_t start=0; start<original_darts; start++){
+		if(visited[start])
+			continue;
+		std::vector<size_t> face;
+		for(auto d = start; !visited[d]; d = succ[d^1]){
+			visited[d] = true;
+			face.push_back(d);
+		}
+
+		auto k = face.size();
+		std::vector<size_t> prev(k), next(k);
+		for(size_t j=0; j<k; j++){
+			prev[j] = (j+k-1)%k;
+			next[j] = (j+1)%k;
+		}
+		std::vector<size_t> queue(k);
+		std::iota(queue.begin(),queue.end(),0);
+		std::vector<bool> removed(k,false);
+
+		while(k > 3 && !queue.empty()){
+			auto j = queue.back();
+			queue.pop_back();
+			if(removed[j])
+				continue;
+			auto a = tail[face[prev[j]]];
+			auto c = tail[face[next[j]]];
+			if(a == c || adjacent.contains(key(a,c)))
+				continue;
+
+			//the new edge closes the triangle a,b,c
+			auto x = addEdge(a,pred[face[prev[j]]],c,succ[face[j]^1]);
+			face[prev[j]] = x;
+			removed[j] = true;
+			next[prev[j]] = next[j];
+			prev[next[j]] = prev[j];
+			queue.push_back(prev[j]);
+			queue.push_back(next[j]);
+			k--;
+		}
+	}
 
-	for(auto&& e : range(edges(g.getGraph())) | std::views::filter(has_index_0))
-		put(edgei_map,e,ecount++);
+	for(size_t v=0; v<n; v++){
+		auto& pi_v = g.rotations[v];
+		pi_v.clear();
+		if(first_dart[v] == none)
+			continue;
+		auto d = first_dart[v];
+		do{
+			pi_v.push_back(edges_by_index[d/2]);
+			d = succ[d];
+		}while(d != first_dart[v]);
+	}
 
-	//make sure the signals vector has the appropriate size and values
-	g.edge_signals.resize(num_edges(g.getGraph()),1);
+	g.edge_signals.resize(ecount,1);
 
-	//make sure the embedding is updated...
-	
-	boyer_myrvold_planarity_test(
-		boost::boyer_myrvold_params::graph = g.getGraph()
-		,boost::boyer_myrvold_params::embedding = rotations_pmap
-		);
-	
 	return g;
 }
 
@@ -86,42 +211,103 @@ struct FacialCyclesVisitor : public boost::planar_face_traversal_visitor{
 };
 
 
-//TODO redo this without using boost and generalized to surfaces
 /**
- * Finds a facial cycle in an embedded graph `g`.
+ * The faces of an orientable embedding in compressed form: the vertices of face f are `vertices[offsets[f]]` to `vertices[offsets[f+1]-1]`.
+ * The dart 2i leaves the source of the edge with index i and 2i+1 leaves its target, and `face_of` has the face on the left of each dart.
+ */
+template <typename Graph>
+struct FaceTable{
+	std::vector<vertex_t<Graph>> vertices;
+	std::vector<size_t> offsets{0};
+	std::vector<size_t> face_of;
+
+	auto numFaces() const -> size_t{
+		return offsets.size()-1;
+	}
+
+	auto face(size_t f) const -> std::span<const vertex_t<Graph>>{
+		return std::span<const vertex_t<Graph>>(vertices.data() + offsets[f], offsets[f+1] - offsets[f]);
+	}
+};
+
+/**
+ * Enumerates the faces of `g`, or only the first `max_faces` of them. A face leaves a vertex through the edge after the one it arrived by in the rotation,
+ * as in Boost's `planar_face_traversal`. The graph must not have loops.
  *
- * Just a wrap around Boost's `planar_face_traversal` function.
+ * Darts of faces not enumerated have face id `max_faces`.
+ */
+template <typename Graph,int Genus>
+auto faceTable(const OrientableEmbeddedGraph<Graph,Genus>& g, const size_t max_faces = std::numeric_limits<size_t>::max()) -> FaceTable<Graph>{
+	auto m = g.numEdges();
+	std::vector<size_t> tail(2*m), next(2*m);
+	std::vector<vertex_t<Graph>> vertex_of(2*m);
+	for(auto&& e : g.edges()){
+		auto [u,v] = g.endpoints(e);
+		auto i = g.index(e);
+		tail[2*i] = g.index(u);
+		tail[2*i+1] = g.index(v);
+		vertex_of[2*i] = u;
+		vertex_of[2*i+1] = v;
+	}
+	for(size_t v=0; v<g.rotations.size(); v++){
+		auto& pi_v = g.rotations[v];
+		auto dart = [&](auto&& e){ auto i = g.index(e); return tail[2*i] == v ? 2*i : 2*i+1; };
+		for(size_t j=0; j<pi_v.size(); j++)
+			next[dart(pi_v[j])] = dart(pi_v[(j+1)%pi_v.size()]);
+	}
+
+	FaceTable<Graph> table;
+	const auto unvisited = std::numeric_limits<size_t>::max();
+	table.face_of.assign(2*m,unvisited);
+	table.vertices.reserve(max_faces < 2*m ? 0 : 2*m);
+
+	for(size_t start=0; start<2*m && table.numFaces() < max_faces; start++){
+		if(table.face_of[start] != unvisited)
+			continue;
+		auto f = table.numFaces();
+		for(auto d = start; table.face_of[d] == unvisited; d = next[d^1]){
+			table.face_of[d] = f;
+			table.vertices.push_back(vertex_of[d]);
+		}
+		table.offsets.push_back(table.vertices.size());
+	}
+
+	for(auto&& f : table.face_of)
+		if(f == unvisited)
+			f = table.numFaces();
+
+	return table;
+}
+
+/**
+ * Finds a facial cycle in an embedded graph `g`. Only the first face is walked.
  */
 template <typename Graph,int Genus>
 auto findFacialCycle(const OrientableEmbeddedGraph<Graph,Genus>& g) -> std::vector<vertex_t<Graph>>{
-	std::vector<std::vector<vertex_t<Graph>>> facial_cycles;
-	FacialCyclesVisitor<vertex_t<Graph>> fcv {facial_cycles};
-	auto rotations_pmap = make_iterator_property_map(g.rotations.begin(),get(boost::vertex_index,g.getGraph()));
-	planar_face_traversal(g.getGraph(),rotations_pmap,fcv);
-	return facial_cycles[0];
+	return faceTable(g,1).vertices;
 }
 
 
 /**
  * Finds the largest facial cycle in an embedded graph `g`.
  *
- * Just a wrap around Boost's `planar_face_traversal` function.
+ * The faces are enumerated with faceTable, and the largest one is moved out of its buffer.
  */
 template <typename Graph>
 auto findLargestFacialCycle(const PlanarGraph<Graph>& g) -> std::vector<vertex_t<Graph>>{
-	std::vector<std::vector<vertex_t<Graph>>> facial_cycles;
-	FacialCyclesVisitor<vertex_t<Graph>> fcv {facial_cycles};
-	auto rotations_pmap = make_iterator_property_map(g.rotations.begin(),get(boost::vertex_index,g.getGraph()));
-	planar_face_traversal(g.getGraph(),rotations_pmap,fcv);
+	auto table = faceTable(g);
+	if(table.numFaces() == 0)
+		return {};
 
-	std::vector<vertex_t<Graph>> largest;
-
-	for(auto&& f : facial_cycles){
-		if (f.size() > largest.size())
+	size_t largest = 0;
+	for(size_t f=1; f<table.numFaces(); f++)
+		if(table.face(f).size() > table.face(largest).size())
 			largest = f;
-	}
 
-	return largest;
+	auto& vertices = table.vertices;
+	vertices.erase(vertices.begin() + table.offsets[largest+1], vertices.end());
+	vertices.erase(vertices.begin(), vertices.begin() + table.offsets[largest]);
+	return std::move(vertices);
 }
 
 /**
@@ -4,6 +4,9 @@
 #include <vector>
 #include <map>
 #include <limits>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/undirected_dfs.hpp>
@@ -12,6 +15,7 @@
 #include <gdraw/graph_types.hpp>
 #include <gdraw/util.hpp>
 #include <gdraw/planar_graphs.hpp>
+#include <gdraw/embedded_graphs.hpp>
 
 namespace gdraw{
 
@@ -31,16 +35,22 @@ auto is1Sided(const NonOrientableEmbeddedGraph<Graph,Genus>& g, const T& cycle)
 }
 
 
+/**
+ * Builds the double cover of `g` where the edges in `xedges` cross between the two copies.
+ *
+ * Vertex v and edge index i of `g` are lifted to the vertices v, v+n and to the edges with
+ * indexes i, i+m (n and m being the order and size of `g`). Hence a cover edge with index j
+ * always projects to the edge j mod m of `g`.
+ */
 template <typename Graph, typename Range>
 requires EdgeRange<Range,Graph>
 auto doubleCover(IndexedGraph<Graph>&& g,Range&& xedges) -> IndexedGraph<Graph>{
 
 	//printGraph(g);
 	auto n = num_vertices(g.getGraph());
-	auto ecount = num_edges(g.getGraph());
+	auto m = num_edges(g.getGraph());
 	auto edgei_map = get( boost::edge_index, g.getGraph());
 
-	//TODO ugly solution... would like to devise something a bit better using the indexes
 	//Adding edges invalidate iterators, we need a cache
 	std::vector<edge_t<Graph>> edges_cache;
 	for(auto&& e : range(edges(g.getGraph()))){
@@ -56,42 +66,51 @@ auto doubleCover(IndexedGraph<Graph>&& g,Range&& xedges) -> IndexedGraph<Graph>{
 	};
 
 	//Makes a copy of the original g on the vertices with index n,2n-1
-	for(auto&& [s,t] : edges_cache | std::views::transform(endpoints)){
+	//copies[i] is the copy of the edge with index i
+	std::vector<edge_t<Graph>> copies(m);
+	for(auto&& e : edges_cache){
+		auto [s,t] = endpoints(e);
+		auto e_index = boost::get(edgei_map,e);
 		auto f = add_edge(s+n,t+n,g.getGraph()).first;
-		boost::put(edgei_map,f,ecount++);
+		boost::put(edgei_map,f,e_index+m);
+		copies[e_index] = f;
 	}
 
 	for(auto&& e : xedges){
 		auto [s,t] = endpoints(e);
-
-		auto f = edge(s+n,t+n,g.getGraph()).first;
+		auto e_index = boost::get(edgei_map,e);
 
 		remove_edge(e,g.getGraph());
-		remove_edge(s+n,t+n,g.getGraph());
-
-		auto e_index = boost::get(edgei_map,e);
-		auto f_index = boost::get(edgei_map,f);
+		remove_edge(copies[e_index],g.getGraph());
 
 		auto f1 = add_edge(s,vertex(t+n,g.getGraph()),g.getGraph()).first;
 		auto f2 = add_edge(vertex(s+n,g.getGraph()),t,g.getGraph()).first;
 		boost::put(edgei_map,f1,e_index);
-		boost::put(edgei_map,f2,f_index);
+		boost::put(edgei_map,f2,e_index+m);
 	}
 
 	return g;
 }
 
 
+/**
+ * Searches for a planar double cover of `g` using the cotree edges of a random spanning tree.
+ *
+ * The spanning tree is generated from `seed`, so equal seeds give equal runs. The search gives up
+ * as soon as `stop` is set.
+ */
 template <typename Graph>
-auto findDoublePlanarCover(IndexedGraph<Graph> g) -> std::optional<PlanarGraph<Graph>>{
+auto findDoublePlanarCover(IndexedGraph<Graph> g, seed_t seed, const std::atomic<bool>& stop) -> std::optional<PlanarGraph<Graph>>{
 
-	auto tree_edges = randomSpanningTree(g);
+	auto tree_edges = randomSpanningTree(g,seed);
 
 	auto cotree_edges = coSubgraphEdges(g,tree_edges);
 
 	std::optional<PlanarGraph<Graph>> maybe_planar;
 
-	auto has_dpc = [&maybe_planar,&g](auto&& edges){
+	auto has_dpc = [&maybe_planar,&g,&stop](auto&& edges){
+		if(stop)
+			return true;
 		auto [h,h_edges] = graph_copy(g,edges);
 		auto dc = doubleCover(std::move(h),std::move(h_edges));
 		auto v = planeEmbedding(std::move(dc));
@@ -112,61 +131,156 @@ auto findDoublePlanarCover(IndexedGraph<Graph> g) -> std::optional<PlanarGraph<G
 	return maybe_planar;
 }
 
+template <typename Graph>
+auto findDoublePlanarCover(IndexedGraph<Graph> g, seed_t seed = randomSeed()) -> std::optional<PlanarGraph<Graph>>{
+	std::atomic<bool> stop = false;
+	return findDoublePlanarCover(std::move(g),seed,stop);
+}
 
-/*
- * parent - a parent vector representing a rooted tree.
- * root - root of the tree represented by parent.
+/**
+ * Runs `trees` searches of findDoublePlanarCover concurrently, each one with its own spanning tree
+ * generated from the seeds `seed`, `seed+1`, ..., `seed+trees-1`. Returns the first cover found.
+ *
+ * The seed of the winning tree is written to `log`, so that the run can be reproduced with
+ * findDoublePlanarCover(g,seed).
  */
 template <typename Graph>
-auto doublePlanarCover(ProjectivePlanarGraph<Graph> g, std::vector<vertex_t<Graph>> parent, vertex_t<Graph> root) -> PlanarGraph<Graph>{
-	//We fix a spanning tree T and check for edges e such that the unique cycle in T+e is non-contractible
-	//These edges are used to calculate the double cover 
+auto findDoublePlanarCoverPortfolio(IndexedGraph<Graph> g, size_t trees, seed_t seed = randomSeed(), std::ostream& log = std::clog) -> std::optional<PlanarGraph<Graph>>{
+
+	std::atomic<bool> found = false;
+	std::mutex result_mutex;
+	std::optional<PlanarGraph<Graph>> result;
+
+	auto search = [&found,&result_mutex,&result,&log](IndexedGraph<Graph> h, seed_t tree_seed){
+		auto maybe_planar = findDoublePlanarCover(std::move(h),tree_seed,found);
+		if(maybe_planar){
+			std::lock_guard<std::mutex> lock(result_mutex);
+			if(!result){
+				result = std::move(maybe_planar);
+				found = true;
+				log << "Double planar cover found with seed " << tree_seed << std::endl;
+			}
+		}
+	};
 
-	std::vector<int> signal_to_root(num_vertices(g.getGraph()),0);
+	//the copies of g are made here, before the threads start
+	std::vector<std::thread> workers;
+	for(size_t i=0; i<trees; i++)
+		workers.emplace_back(search,g,seed+i);
 
-	signal_to_root[root]=1;
+	for(auto&& w : workers)
+		w.join();
 
-	std::vector<vertex_t<Graph>> stack;
-	
-	auto edgei_map = get( boost::edge_index, g.getGraph());
+	return result;
+}
+
+
+/**
+ * Test whether `g` embeds in the projective plane by searching for a planar double cover,
+ * as in findDoublePlanarCover. Isolated vertices are ignored.
+ *
+ * @return : A `std::variant` containing either the graph with an embedding (`ProjectivePlanarGraph`) or with a list of edges inducing a subgraph that does not embed in the projective plane (`NonEmbeddableGraph`). The latter contains the spanning tree used and the projections of the Kuratowski subgraphs of every double cover tried.
+ */
+template <typename Graph>
+auto projectivePlaneEmbedding(IndexedGraph<Graph> g, seed_t seed, const std::atomic<bool>& stop) -> std::variant<ProjectivePlanarGraph<Graph>,NonEmbeddableGraph<Graph>>{
+
+	//boost's random spanning tree does not deal with isolated vertices
+	auto [h,h_map] = createSubgraph(g,g.edges());
+
+	auto m = h.numEdges();
+
+	auto tree_edges = randomSpanningTree(h,seed);
+	auto cotree_edges = coSubgraphEdges(h,tree_edges);
+
+	//If no cover is planar, the spanning tree and the projection of the Kuratowski subgraphs
+	//induce a subgraph that is not projective-planar either
+	std::vector<bool> in_obstruction(m,false);
+	for(auto&& e : tree_edges)
+		in_obstruction[h.index(e)] = true;
+
+	std::optional<ProjectivePlanarGraph<Graph>> maybe_pp;
 
-	//Here we calculate the signal of the path from the vertex to the root
-	for(auto&& v : range(vertices(g.getGraph()))){
-		auto w = v;
-		while(signal_to_root[w] == 0 or w != root){
-			stack.push_back(w);
-			w = parent[w];
+	auto has_dpc = [&maybe_pp,&h,&m,&in_obstruction,&stop](auto&& edges){
+		if(stop)
+			return true;
+		auto [c,c_edges] = graph_copy(h,edges);
+		auto dc = doubleCover(std::move(c),std::move(c_edges));
+		auto v = planeEmbedding(std::move(dc));
+		if(std::holds_alternative<PlanarGraph<Graph>>(v)){
+			maybe_pp = embeddingFromDPC(std::move(std::get<0>(v)));
+			return true;
 		}
-		while(!stack.empty()){
-			auto u = stack.back();
-			stack.pop_back();
-			auto e = edge(u,w,g.getGraph()).first;
-			signal_to_root[u] = signal_to_root[w] * g.edge_signals[get(edgei_map,e)];
-			w = u;
+		auto& npg = std::get<1>(v);
+		for(auto&& e : npg.forbidden_subgraph)
+			in_obstruction[npg.index(e) % m] = true;
+		return false;
+	};
+
+	gdraw::enumerate(0,cotree_edges.size(),cotree_edges,has_dpc);
+
+	if(maybe_pp){
+		//maps the embedding back to the edges and vertices of g
+		auto& pp = maybe_pp.value();
+		rotations_t<Graph> rotations(g.numVertices());
+		std::vector<int> edge_signals(g.numEdges(),1);
+
+		for(auto&& u : pp.vertices()){
+			auto gu = h_map.ivertex_map[pp.index(u)];
+			for(auto&& e : pp.rotations[pp.index(u)]){
+				auto ge = h_map.iedge_map[pp.index(e)];
+				rotations[g.index(gu)].push_back(ge);
+				edge_signals[g.index(ge)] = pp.signal(e);
+			}
 		}
+
+		return ProjectivePlanarGraph<Graph>(std::move(g),std::move(rotations),std::move(edge_signals));
 	}
 
+	std::vector<edge_t<Graph>> obstruction;
+	if(!stop)
+		for(size_t i=0; i<m; i++)
+			if(in_obstruction[i])
+				obstruction.push_back(h_map.iedge_map[i]);
+
+	return NonEmbeddableGraph<Graph>(std::move(g),std::move(obstruction));
+}
+
+template <typename Graph>
+auto projectivePlaneEmbedding(IndexedGraph<Graph> g, seed_t seed = randomSeed()) -> std::variant<ProjectivePlanarGraph<Graph>,NonEmbeddableGraph<Graph>>{
+	std::atomic<bool> stop = false;
+	return projectivePlaneEmbedding(std::move(g),seed,stop);
+}
+
+/*
+ * parent - a parent vector representing a rooted tree.
+ * root - root of the tree represented by parent.
+ */
+template <typename Graph>
+auto doublePlanarCover(ProjectivePlanarGraph<Graph> g, std::vector<vertex_t<Graph>> parent, [[maybe_unused]] vertex_t<Graph> root) -> PlanarGraph<Graph>{
+	//We fix a spanning tree T and check for edges e such that the unique cycle in T+e is non-contractible
+	//These edges are used to calculate the double cover 
+
+	//The root is the only vertex without a parent in the tree
+	std::vector<std::optional<edge_t<Graph>>> tree(g.numVertices());
 	std::vector<edge_t<Graph>> tree_edges;
 
-	for(auto v : range(vertices(g.getGraph())))
-		if(parent[v] != boost::graph_traits<Graph>::null_vertex())
-			tree_edges.push_back(edge(v,parent[v],g.getGraph()).first);
+	for(auto v : g.vertices())
+		if(parent[v] != boost::graph_traits<Graph>::null_vertex()){
+			auto e = edge(v,parent[v],g.getGraph()).first;
+			tree[g.index(v)] = e;
+			tree_edges.push_back(e);
+		}
 	
-	auto cotree_edges = coSubgraphEdges(g,tree_edges);
+	//The paths may have a a common subpath to root, but since it it counted twice it doesn't matter (Z/2Z)
+	SignalParityIndex<Graph> parity(g,tree);
 
-	auto endpoints = [&g](auto&& e){
-		return std::make_tuple(source(e,g.getGraph()),target(e,g.getGraph()));
-	};
+	auto cotree_edges = coSubgraphEdges(g,tree_edges);
 
 	std::vector<edge_t<Graph>> xedges;
 
-	//The paths may have a a common subpath to root, but since it it counted twice it doesn't matter (Z/2Z)
-	for(auto&& e : cotree_edges){
-		auto [u,v] = endpoints(e);
-		auto e_signal = g.edge_signals[get(edgei_map,e)];
-		if(signal_to_root[u] * signal_to_root[v] * e_signal == -1)
+	for(auto&& e : cotree_edges)
+		if(parity.is1Sided(e))
 			xedges.push_back(e);
-	}
 
 	//TODO need to make an embedding from the xedges...
 	auto dc = doubleCover(std::move(g),xedges);
@@ -176,12 +290,15 @@ auto doublePlanarCover(ProjectivePlanarGraph<Graph> g, std::vector<vertex_t<Grap
 
 }
 
+/*
+ * Same as above, with a random spanning tree generated from `seed`.
+ */
 template <typename Graph>
-auto doublePlanarCover(ProjectivePlanarGraph<Graph> g) -> PlanarGraph<Graph>{
+auto doublePlanarCover(ProjectivePlanarGraph<Graph> g, seed_t seed = randomSeed()) -> PlanarGraph<Graph>{
 
 	std::vector<vertex_t<Graph>> parent(num_vertices(g.getGraph()),boost::graph_traits<Graph>::null_vertex());
 
-	boost::mt19937 gen(time(0));
+	boost::mt19937 gen(seed);
 	boost::random_spanning_tree(g.getGraph(),gen,boost::predecessor_map(&parent[0]));
 
 	auto root = *(vertices(g.getGraph()).first);
@@ -190,77 +307,56 @@ auto doublePlanarCover(ProjectivePlanarGraph<Graph> g) -> PlanarGraph<Graph>{
 
 }
 
+/**
+ * Projects a double planar cover of a graph into an embedding of the graph in the projective plane.
+ *
+ * The edge indexes of `g` are expected to follow the convention of doubleCover: the edge with 
+ * index j projects to the edge j mod m, where m is half the size of `g`.
+ */
 template <typename Graph>
 auto embeddingFromDPC(PlanarGraph<Graph> g) -> ProjectivePlanarGraph<Graph>{
 	
 	//Due to the complexity of the operations clearVertex and remove_vertex, creating a new graph is simply faster
-	auto n = num_vertices(g.getGraph());
-	Graph h = Graph(n/2);
-
-	auto endpoints = [&g](auto&& e){
-		return std::make_tuple(source(e,g.getGraph()),target(e,g.getGraph()));
-	};
+	auto n = g.numVertices()/2;
+	auto m = g.numEdges()/2;
 
-	auto is_x_edge = [&n,&endpoints](auto&& e){
-		auto [u,v] = endpoints(e);
-		if((u < n/2 && v>=n/2) ||
-			(u >=n/2 && v < n/2))
-			return true;
-		return false;
-	};
+	//the edges are added to the wrapped graph so the descriptors in the rotations stay valid
+	IndexedGraph<Graph> h{Graph(n)};
 
-	auto project = [&n](auto&& v){
-		return v % (n/2);
+	auto is_x_edge = [&g,&n](auto&& e){
+		auto [u,v] = g.endpoints(e);
+		return (u < n) != (v < n);
 	};
 
-
-	//We need to maintain the multiplicity of edges
-	//We first count the number of edges that project to to a single edge
-	//Each edge will have twice their multiplicity as projections
-	std::map<std::tuple<vertex_t<Graph>,vertex_t<Graph>>,size_t> count_projections;
-	for(auto&& e : range(edges(g.getGraph()))){
-		auto [u,v] = endpoints(e);
-		u = project(u);
-		v = project(v);
-		++count_projections[std::make_tuple(u,v)];
+	//endpoints of the projected edges, by index
+	std::vector<std::pair<vertex_t<Graph>,vertex_t<Graph>>> projected_endpoints(m);
+	for(auto&& e : g.edges()){
+		auto e_index = g.index(e);
+		if(e_index < m){
+			auto [u,v] = g.endpoints(e);
+			projected_endpoints[e_index] = {u % n, v % n};
+		}
 	}
 
-	auto edgei_map = boost::get(boost::edge_index,h);
-	size_t h_ecount =0;
-
-	//We now add exactly half the multiplicity of the projected edges
-	for(auto&& [p,e_count] : count_projections){
-		//std::cout << e << ' ' << e_count << std::endl;
-		//auto [u,v] = endpoints(e);
-		auto [u,v] = p;
-		//std::cout << u << ' ' << v << ' ' << e_count << std::endl;
-		for([[maybe_unused]]auto&& _ : std::views::iota((size_t)0,e_count/2)){
-			auto f = add_edge(u,v,h).first;
-			boost::put(edgei_map,f,h_ecount++);
-		}
+	std::vector<edge_t<Graph>> h_edges(m);
+
+	for(size_t i=0; i<m; i++){
+		auto [u,v] = projected_endpoints[i];
+		h_edges[i] = h.addEdge(u,v,i);
 	}
 
-	rotations_t<Graph> h_rotations(n/2);
-	std::vector<int> edge_signals(num_edges(h),1);
+	rotations_t<Graph> h_rotations(n);
+	std::vector<int> edge_signals(m,1);
 
-	for(size_t u =0;u<n/2;u++)
+	for(size_t u =0;u<n;u++){
+		h_rotations[u].reserve(g.rotations[u].size());
 		for(auto&& e : g.rotations[u]){
-			auto [v,w] = endpoints(e);
-			edge_t<Graph> f;
-			if(is_x_edge(e)){
-				v = project(v);
-				w = project(w);
-				f = edge(v,w,h).first;
-				auto f_index = boost::get(edgei_map,f);
-				h_rotations[u].push_back(f);
+			auto f_index = g.index(e) % m;
+			h_rotations[u].push_back(h_edges[f_index]);
+			if(is_x_edge(e))
 				edge_signals[f_index] = -1;
-			}else{
-				auto f = edge(v,w,h).first;
-				auto f_index = boost::get(edgei_map,f);
-				h_rotations[u].push_back(f);
-				edge_signals[f_index] = 1;
-			}
 		}
+	}
 
 	return ProjectivePlanarGraph<Graph>{std::move(h),std::move(h_rotations),std::move(edge_signals)};
 }
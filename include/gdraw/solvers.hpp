@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <armadillo>
+
+namespace gdraw{
+
+/**
+ * Returns the Jacobi (diagonal) preconditioner of a sparse symmetric matrix `A` as a function r -> D^{-1} r.
+ */
+inline auto jacobiPreconditioner(const arma::sp_mat& A){
+	arma::vec inv_diag = arma::vec(A.diag());
+	for(size_t i=0; i<inv_diag.n_elem; i++)
+		inv_diag(i) = inv_diag(i) != 0 ? 1/inv_diag(i) : 1;
+
+	return [inv_diag = std::move(inv_diag)](const arma::vec& r) -> arma::vec{
+		return inv_diag % r;
+	};
+}
+
+/**
+ * Solves Ax=b for a sparse symmetric positive definite `A` with the preconditioned conjugate gradient method, starting from `x`.
+ * It stops when the residual is at most `tol` times the norm of b, or after `max_iter` iterations (10n by default).
+ *
+ * @param precond : A function r -> z approximating the solution of Az = r.
+ */
+template <typename Preconditioner>
+auto conjugateGradient(const arma::sp_mat& A, const arma::vec& b, arma::vec x, Preconditioner&& precond, const double tol = 1e-10, size_t max_iter = 0) -> arma::vec{
+	if(max_iter == 0)
+		max_iter = 10*A.n_rows + 10;
+
+	auto b_norm = arma::norm(b);
+	if(b_norm == 0)
+		b_norm = 1;
+
+	arma::vec r = b - A*x;
+	if(arma::norm(r) <= tol * b_norm)
+		return x;
+
+	arma::vec z = precond(r);
+	arma::vec p = z;
+	double rz = arma::dot(r,z);
+
+	for(size_t k=0; k<max_iter; k++){
+		arma::vec Ap = A*p;
+		double alpha = rz / arma::dot(p,Ap);
+		x += alpha * p;
+		r -= alpha * Ap;
+		if(arma::norm(r) <= tol * b_norm)
+			break;
+		z = precond(r);
+		double rz_next = arma::dot(r,z);
+		p = z + (rz_next/rz) * p;
+		rz = rz_next;
+	}
+
+	return x;
+}
+
+/**
+ * A multilevel (algebraic multigrid) preconditioner for sparse symmetric positive definite matrices such as the systems of Tutte's algorithm.
+ *
+ * Each level is coarsened by contracting stars of the graph of the matrix: a vertex with no aggregated neighbor is merged with all its neighbors, 
+ * and the remaining vertices join a neighboring aggregate. The coarse matrix is the Galerkin product P^T A P, where P maps each vertex to its aggregate.
+ * Applying the preconditioner is one V-cycle with damped Jacobi smoothing. The coarsest level is solved directly if it has at most `max_dense` rows,
+ * and otherwise, when the coarsening stalls on a large level, it gets `sweeps` damped Jacobi sweeps like the others.
+ */
+class MultilevelPreconditioner{
+
+	public:
+		MultilevelPreconditioner(arma::sp_mat A, const size_t coarsest = 100, const size_t sweeps = 2, const double omega = 2.0/3):
+		sweeps(sweeps), omega(omega){
+
+			while(true){
+				Level level;
+				level.A = std::move(A);
+				level.inv_diag = arma::vec(level.A.diag());
+				for(size_t i=0; i<level.inv_diag.n_elem; i++)
+					level.inv_diag(i) = level.inv_diag(i) != 0 ? 1/level.inv_diag(i) : 1;
+
+				auto n = level.A.n_rows;
+				if(n <= coarsest){
+					levels.push_back(std::move(level));
+					break;
+				}
+
+				auto [aggregate,count] = aggregates(level.A);
+				//coarsening stalled
+				if(10*count > 9*n){
+					levels.push_back(std::move(level));
+					break;
+				}
+
+				arma::umat locations(2,n);
+				arma::vec values(n,arma::fill::ones);
+				for(size_t i=0; i<n; i++){
+					locations(0,i) = i;
+					locations(1,i) = aggregate[i];
+				}
+				level.P = arma::sp_mat(locations,values,n,count);
+				A = level.P.t() * level.A * level.P;
+				levels.push_back(std::move(level));
+			}
+
+			auto& last = levels.back().A;
+			if(last.n_rows > max_dense)
+				return;
+			arma::mat dense(last.n_rows,last.n_cols,arma::fill::zeros);
+			for(auto it = last.begin(); it != last.end(); ++it)
+				dense(it.row(),it.col()) = *it;
+			coarse_inverse = arma::inv_sympd(dense);
+		}
+
+		auto operator()(const arma::vec& r) const -> arma::vec{
+			return vCycle(0,r);
+		}
+
+		auto numLevels() const -> size_t{
+			return levels.size();
+		}
+
+	private:
+		struct Level{
+			arma::sp_mat A;
+			arma::sp_mat P;
+			arma::vec inv_diag;
+		};
+
+		static constexpr size_t max_dense = 500;
+
+		std::vector<Level> levels;
+		arma::mat coarse_inverse;
+		size_t sweeps;
+		double omega;
+
+		static auto aggregates(const arma::sp_mat& A) -> std::pair<std::vector<size_t>,size_t>{
+			auto n = A.n_rows;
+			std::vector<std::vector<size_t>> neighbors(n);
+			for(auto it = A.begin(); it != A.end(); ++it)
+				if(it.row() != it.col())
+					neighbors[it.row()].push_back(it.col());
+
+			const auto none = n;
+			std::vector<size_t> aggregate(n,none);
+			size_t count = 0;
+
+			for(size_t i=0; i<n; i++){
+				if(aggregate[i] != none)
+					continue;
+				auto free = std::all_of(neighbors[i].begin(),neighbors[i].end(),[&](auto j){ return aggregate[j] == none; });
+				if(!free)
+					continue;
+				aggregate[i] = count;
+				for(auto&& j : neighbors[i])
+					aggregate[j] = count;
+				count++;
+			}
+
+			for(size_t i=0; i<n; i++){
+				if(aggregate[i] != none)
+					continue;
+				for(auto&& j : neighbors[i])
+					if(aggregate[j] != none){
+						aggregate[i] = aggregate[j];
+						break;
+					}
+				if(aggregate[i] == none)
+					aggregate[i] = count++;
+			}
+
+			return {aggregate,count};
+		}
+
+		auto vCycle(const size_t l, const arma::vec& r) const -> arma::vec{
+			auto& level = levels[l];
+			if(l+1 == levels.size() && level.A.n_rows <= max_dense)
+				return coarse_inverse * r;
+
+			arma::vec z = omega * (level.inv_diag % r);
+			for(size_t k=1; k<sweeps; k++)
+				z += omega * (level.inv_diag % (r - level.A*z));
+			if(l+1 == levels.size())
+				return z;
+
+			arma::vec coarse_r = level.P.t() * (r - level.A*z);
+			z += level.P * vCycle(l+1,coarse_r);
+
+			for(size_t k=0; k<sweeps; k++)
+				z += omega * (level.inv_diag % (r - level.A*z));
+
+			return z;
+		}
+};
+
+/**
+ * Solves Ax=b with the Jacobi preconditioned conjugate gradient method, starting from zero.
+ */
+inline auto conjugateGradient(const arma::sp_mat& A, const arma::vec& b, const double tol = 1e-10) -> arma::vec{
+	return conjugateGradient(A,b,arma::vec(b.n_elem,arma::fill::zeros),jacobiPreconditioner(A),tol);
+}
+
+} //namespace
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <optional>
+#include <algorithm>
+
+#include <gdraw/graph_types.hpp>
+#include <gdraw/coordinates.hpp>
+
+namespace gdraw{
+
+/**
+ * Appends to `polyline` the points of an approximation of a cubic Bézier curve by de Casteljau subdivision,
+ * until the control points are within `tolerance` of the chord. The starting point is not included.
+ */
+inline auto flattenSpline(const cubicSpline& s, const double tolerance, std::vector<coord_t>& polyline, const size_t depth = 0) -> void{
+	auto distance_to_chord = [&s](const coord_t& p){
+		auto dx = s.to.x - s.from.x;
+		auto dy = s.to.y - s.from.y;
+		auto length = std::hypot(dx,dy);
+		if(length == 0)
+			return std::hypot(p.x - s.from.x, p.y - s.from.y);
+		return std::abs(dx*(s.from.y - p.y) - dy*(s.from.x - p.x))/length;
+	};
+
+	if(depth >= 16 || std::max(distance_to_chord(s.control1),distance_to_chord(s.control2)) <= tolerance){
+		polyline.push_back(s.to);
+		return;
+	}
+
+	auto mid = [](const coord_t& a, const coord_t& b){ return coord_t{(a.x+b.x)/2,(a.y+b.y)/2}; };
+	auto p01 = mid(s.from,s.control1);
+	auto p12 = mid(s.control1,s.control2);
+	auto p23 = mid(s.control2,s.to);
+	auto p012 = mid(p01,p12);
+	auto p123 = mid(p12,p23);
+	auto p0123 = mid(p012,p123);
+
+	flattenSpline({s.from,p01,p012,p0123},tolerance,polyline,depth+1);
+	flattenSpline({p0123,p123,p23,s.to},tolerance,polyline,depth+1);
+}
+
+/**
+ * A uniform grid over the geometry of a drawing. The vertices are kept as points, and the edges as segments:
+ * straight edges are one segment, and the edges with `edge_coordinates` are flattened cubic Bézier curves.
+ * The grid has about one segment per cell. Points and segments outside the initial bounding box go to the border cells, so the index stays valid as vertices move.
+ *
+ * Vertices and edges are referred to by their indices.
+ */
+class SpatialIndex{
+
+	public:
+		struct Segment{
+			size_t edge;
+			coord_t a;
+			coord_t b;
+			//whether a is an endpoint of the edge
+			bool first;
+		};
+
+		/**
+		 * Builds the index of `g`. The curves are flattened and the cells filled by `threads` threads.
+		 */
+		template <typename Graph>
+		SpatialIndex(const DrawnGraph<Graph>& g, size_t threads = 1): points(g.coordinates), ends(g.numEdges()), incident(g.numVertices()){
+			threads = std::max(threads,(size_t)1);
+
+			for(auto&& e : g.edges()){
+				auto [u,v] = g.endpoints(e);
+				ends[g.index(e)] = {g.index(u),g.index(v)};
+				incident[g.index(u)].push_back(g.index(e));
+				if(u != v)
+					incident[g.index(v)].push_back(g.index(e));
+			}
+
+			double max_x = 0, max_y = 0;
+			if(!points.empty()){
+				min_x = max_x = points[0].x;
+				min_y = max_y = points[0].y;
+			}
+			auto extend = [&](const coord_t& p){
+				min_x = std::min(min_x,p.x);
+				max_x = std::max(max_x,p.x);
+				min_y = std::min(min_y,p.y);
+				max_y = std::max(max_y,p.y);
+			};
+			for(auto&& p : points)
+				extend(p);
+			for(auto&& i : g.edge_coordinates.indices()){
+				extend(g.edge_coordinates.at(i).control1);
+				extend(g.edge_coordinates.at(i).control2);
+			}
+			auto tolerance = 1e-3 * std::max(std::hypot(max_x - min_x, max_y - min_y),1e-9);
+
+			//each thread flattens a chunk of the edges
+			std::vector<std::vector<Segment>> chunks(threads);
+			auto flatten = [&](size_t t){
+				for(auto ei = t; ei < ends.size(); ei += threads){
+					if(g.edge_coordinates.contains(ei)){
+						auto& s = g.edge_coordinates.at(ei);
+						std::vector<coord_t> polyline{s.from};
+						flattenSpline(s,tolerance,polyline);
+						for(size_t j=0; j+1<polyline.size(); j++)
+							chunks[t].push_back({ei,polyline[j],polyline[j+1],j==0});
+					}
+					else
+						chunks[t].push_back({ei,points[ends[ei].first],points[ends[ei].second],true});
+				}
+			};
+			parallel(threads,flatten);
+
+			for(auto&& chunk : chunks)
+				segments.insert(segments.end(),chunk.begin(),chunk.end());
+			//the order does not depend on the number of threads
+			std::stable_sort(segments.begin(),segments.end(),[](auto& s, auto& t){ return s.edge < t.edge; });
+			straight.assign(ends.size(),segments.size());
+			for(size_t i=0; i<segments.size(); i++)
+				if(!g.edge_coordinates.contains(segments[i].edge))
+					straight[segments[i].edge] = i;
+
+			side = std::max((size_t)1,(size_t)std::sqrt((double)std::max(segments.size(),points.size())));
+			cell_width = std::max((max_x - min_x)/side,1e-12);
+			cell_height = std::max((max_y - min_y)/side,1e-12);
+			vertex_cells.resize(side*side);
+			segment_cells.resize(side*side);
+
+			//each thread fills a band of rows, so no cell is shared, from the points and segments bucketed by band
+			std::vector<size_t> band(side);
+			for(size_t t=0; t<threads; t++)
+				for(auto r = t*side/threads; r < (t+1)*side/threads; r++)
+					band[r] = t;
+			std::vector<std::vector<size_t>> band_points(threads), band_segments(threads);
+			for(size_t v=0; v<points.size(); v++)
+				band_points[band[row(points[v].y)]].push_back(v);
+			for(size_t i=0; i<segments.size(); i++){
+				auto [r0,r1,c0,c1] = cellRange(segments[i].a,segments[i].b);
+				for(auto t = band[r0]; t <= band[r1]; t++)
+					band_segments[t].push_back(i);
+			}
+
+			auto fill = [&](size_t t){
+				auto first_row = t*side/threads, last_row = (t+1)*side/threads;
+				for(auto&& v : band_points[t])
+					vertex_cells[row(points[v].y)*side + column(points[v].x)].push_back(v);
+				for(auto&& i : band_segments[t]){
+					auto [r0,r1,c0,c1] = cellRange(segments[i].a,segments[i].b);
+					for(auto r = std::max(r0,first_row); r <= r1 && r < last_row; r++)
+						for(auto c = c0; c <= c1; c++)
+							segment_cells[r*side+c].push_back(i);
+				}
+			};
+			parallel(threads,fill);
+		}
+
+		auto numSegments() const -> size_t{
+			return segments.size();
+		}
+
+		auto segment(size_t i) const -> const Segment&{
+			return segments[i];
+		}
+
+		auto coordinates(size_t v) const -> const coord_t&{
+			return points[v];
+		}
+
+		/**
+		 * Returns the vertices inside the rectangle with opposite corners `p` and `q`.
+		 */
+		auto verticesIn(const coord_t& p, const coord_t& q) const -> std::vector<size_t>{
+			auto [r0,r1,c0,c1] = cellRange(p,q);
+			std::vector<size_t> result;
+			for(auto r=r0; r<=r1; r++)
+				for(auto c=c0; c<=c1; c++)
+					for(auto&& v : vertex_cells[r*side+c])
+						if(inside(points[v],p,q))
+							result.push_back(v);
+			std::sort(result.begin(),result.end());
+			return result;
+		}
+
+		/**
+		 * Returns the edges with a segment whose bounding box meets the rectangle with opposite corners `p` and `q`.
+		 */
+		auto edgesIn(const coord_t& p, const coord_t& q) const -> std::vector<size_t>{
+			std::vector<size_t> result;
+			for(auto&& i : segmentCandidates(p,q))
+				result.push_back(segments[i].edge);
+			result.erase(std::unique(result.begin(),result.end()),result.end());
+			return result;
+		}
+
+		/**
+		 * Returns the segments whose bounding box meets the bounding box of the segment from `a` to `b`, sorted.
+		 */
+		auto segmentCandidates(const coord_t& a, const coord_t& b) const -> std::vector<size_t>{
+			auto [r0,r1,c0,c1] = cellRange(a,b);
+			std::vector<size_t> result;
+			for(auto r=r0; r<=r1; r++)
+				for(auto c=c0; c<=c1; c++)
+					for(auto&& i : segment_cells[r*side+c])
+						if(boxesMeet(segments[i].a,segments[i].b,a,b))
+							result.push_back(i);
+			std::sort(result.begin(),result.end());
+			result.erase(std::unique(result.begin(),result.end()),result.end());
+			return result;
+		}
+
+		/**
+		 * Returns the vertex closest to `p`, searching the cells in rings around the cell of `p`.
+		 */
+		auto nearestVertex(const coord_t& p) const -> std::optional<size_t>{
+			std::optional<size_t> best;
+			double best_d2 = 0;
+			auto r0 = row(p.y), c0 = column(p.x);
+			auto step = std::min(cell_width,cell_height);
+
+			for(size_t radius=0; radius<=side; radius++){
+				auto visit = [&](size_t r, size_t c){
+					for(auto&& v : vertex_cells[r*side+c]){
+						auto dx = points[v].x - p.x, dy = points[v].y - p.y;
+						auto d2 = dx*dx + dy*dy;
+						if(!best || d2 < best_d2 || (d2 == best_d2 && v < *best)){
+							best = v;
+							best_d2 = d2;
+						}
+					}
+				};
+				auto r_lo = r0 >= radius ? r0 - radius : 0, r_hi = std::min(side-1,r0 + radius);
+				auto c_lo = c0 >= radius ? c0 - radius : 0, c_hi = std::min(side-1,c0 + radius);
+				for(auto r=r_lo; r<=r_hi; r++)
+					for(auto c=c_lo; c<=c_hi; c++)
+						if(r+radius == r0 || r == r0+radius || c+radius == c0 || c == c0+radius)
+							visit(r,c);
+
+				//the cells not visited yet are at least radius cells away
+				if(best && best_d2 <= (radius*step)*(radius*step))
+					break;
+			}
+			return best;
+		}
+
+		/**
+		 * Returns the pairs of segments of non-adjacent edges whose bounding boxes meet. Each pair is reported once,
+		 * by the cell holding the lower left corner of the intersection of the two bounding boxes.
+		 */
+		auto candidatePairs() const -> std::vector<std::pair<size_t,size_t>>{
+			std::vector<std::pair<size_t,size_t>> result;
+			for(size_t cell=0; cell<segment_cells.size(); cell++){
+				auto& bucket = segment_cells[cell];
+				for(size_t i=0; i<bucket.size(); i++)
+					for(size_t j=i+1; j<bucket.size(); j++){
+						auto& s = segments[bucket[i]];
+						auto& t = segments[bucket[j]];
+						if(s.edge == t.edge || adjacent(s.edge,t.edge) || !boxesMeet(s.a,s.b,t.a,t.b))
+							continue;
+						auto x = std::max(std::min(s.a.x,s.b.x),std::min(t.a.x,t.b.x));
+						auto y = std::max(std::min(s.a.y,s.b.y),std::min(t.a.y,t.b.y));
+						if(row(y)*side + column(x) == cell)
+							result.push_back(std::minmax(bucket[i],bucket[j]));
+					}
+			}
+			return result;
+		}
+
+		/**
+		 * Moves vertex `v` to `p`, updating its cell and the segments of its straight edges. Curved edges keep their `edge_coordinates`.
+		 */
+		auto moveVertex(size_t v, const coord_t& p) -> void{
+			std::erase(vertex_cells[row(points[v].y)*side + column(points[v].x)],v);
+			points[v] = p;
+			vertex_cells[row(p.y)*side + column(p.x)].push_back(v);
+
+			for(auto&& e : incident[v]){
+				auto i = straight[e];
+				if(i == segments.size())
+					continue;
+				forEachCell(segments[i].a,segments[i].b,[&](auto& bucket){ std::erase(bucket,i); });
+				segments[i].a = points[ends[e].first];
+				segments[i].b = points[ends[e].second];
+				forEachCell(segments[i].a,segments[i].b,[&](auto& bucket){ bucket.push_back(i); });
+			}
+		}
+
+		auto adjacent(size_t e, size_t f) const -> bool{
+			auto [a,b] = ends[e];
+			auto [c,d] = ends[f];
+			return a==c || a==d || b==c || b==d;
+		}
+
+		/**
+		 * Checks if two segments cross. Segments are half-open, so that a crossing at a joint of a polyline is found once,
+		 * and the endpoints of the edges are excluded.
+		 */
+		static auto segmentsCross(const Segment& s, const Segment& t) -> bool{
+			auto rx = s.b.x - s.a.x, ry = s.b.y - s.a.y;
+			auto qx = t.b.x - t.a.x, qy = t.b.y - t.a.y;
+			auto wx = t.a.x - s.a.x, wy = t.a.y - s.a.y;
+			auto det = rx*qy - ry*qx;
+			if(det == 0)
+				return false;
+			auto p = (wx*qy - wy*qx)/det;
+			auto q = (wx*ry - wy*rx)/det;
+			auto inside = [](double x, bool first){ return (first ? x > 0 : x >= 0) && x < 1; };
+			return inside(p,s.first) && inside(q,t.first);
+		}
+
+	private:
+		std::vector<coord_t> points;
+		std::vector<std::pair<size_t,size_t>> ends;
+		std::vector<std::vector<size_t>> incident;
+		std::vector<Segment> segments;
+		//the segment of each straight edge, or segments.size() for curves
+		std::vector<size_t> straight;
+
+		double min_x = 0;
+		double min_y = 0;
+		double cell_width = 1;
+		double cell_height = 1;
+		size_t side = 1;
+		std::vector<std::vector<size_t>> vertex_cells;
+		std::vector<std::vector<size_t>> segment_cells;
+
+		template <typename F>
+		static auto parallel(size_t threads, F&& f) -> void{
+			std::vector<std::thread> workers;
+			for(size_t t=1; t<threads; t++)
+				workers.emplace_back(f,t);
+			f(0);
+			for(auto&& w : workers)
+				w.join();
+		}
+
+		auto column(double x) const -> size_t{
+			return std::min(side-1,(size_t)std::max(0.0,(x - min_x)/cell_width));
+		}
+
+		auto row(double y) const -> size_t{
+			return std::min(side-1,(size_t)std::max(0.0,(y - min_y)/cell_height));
+		}
+
+		auto cellRange(const coord_t& a, const coord_t& b) const -> std::tuple<size_t,size_t,size_t,size_t>{
+			return {row(std::min(a.y,b.y)),row(std::max(a.y,b.y)),column(std::min(a.x,b.x)),column(std::max(a.x,b.x))};
+		}
+
+		template <typename F>
+		auto forEachCell(const coord_t& a, const coord_t& b, F&& f) -> void{
+			auto [r0,r1,c0,c1] = cellRange(a,b);
+			for(auto r=r0; r<=r1; r++)
+				for(auto c=c0; c<=c1; c++)
+					f(segment_cells[r*side+c]);
+		}
+
+		static auto inside(const coord_t& p, const coord_t& a, const coord_t& b) -> bool{
+			return std::min(a.x,b.x) <= p.x && p.x <= std::max(a.x,b.x) && std::min(a.y,b.y) <= p.y && p.y <= std::max(a.y,b.y);
+		}
+
+		static auto boxesMeet(const coord_t& a, const coord_t& b, const coord_t& c, const coord_t& d) -> bool{
+			return std::max(std::min(a.x,b.x),std::min(c.x,d.x)) <= std::min(std::max(a.x,b.x),std::max(c.x,d.x)) &&
+				std::max(std::min(a.y,b.y),std::min(c.y,d.y)) <= std::min(std::max(a.y,b.y),std::max(c.y,d.y));
+		}
+};
+
+}//namespace
@@ -0,0 +1,996 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <array>
+#include <numeric>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <queue>
+#include <tuple>
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/boyer_myrvold_planar_test.hpp>
+
+#include <gdraw/graph_types.hpp>
+
+namespace gdraw{
+
+/**
+ * The SPQR-tree of a biconnected graph, that is, the tree of its triconnected components [5]. Each node has a skeleton:
+ * a cycle (S), a bond of parallel edges (P) or a triconnected graph (R). The skeleton edges are real edges of the graph or virtual edges,
+ * and each virtual edge has a twin in the adjacent node. Neighboring nodes never have both type S or both type P.
+ *
+ * The split components are all found in a single path search of Hopcroft and Tarjan [6] with the corrections of Gutwenger and Mutzel [7],
+ * with bucket sorts for the multiple edges and the order of the arcs, in O(n+m) time. Then adjacent cycles and adjacent bonds are merged with a union-find over the virtual edges.
+ *
+ * The planar embeddings of the graph are the choices of an order of the edges of each P-node and of a mirror of each R-node,
+ * so they are enumerated by embeddings() from one embedding of each R skeleton, without more planarity tests.
+ */
+template <typename Graph>
+class SPQRTree{
+
+	public:
+		enum class NodeType{S,P,R};
+
+		static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+		/**
+		 * An edge of a skeleton: its endpoints as vertex indices of the graph and the index of its real edge, or none when it is virtual.
+		 * The twin of a virtual edge is edge `twin_edge` of node `twin_node`.
+		 */
+		struct SkeletonEdge{
+			size_t u;
+			size_t v;
+			size_t real = none;
+			size_t twin_node = none;
+			size_t twin_edge = none;
+		};
+
+		struct Node{
+			NodeType type;
+			//sorted vertex indices of the graph
+			std::vector<size_t> vertices;
+			std::vector<SkeletonEdge> edges;
+		};
+
+		/**
+		 * Decomposes `g`, which must be biconnected.
+		 */
+		SPQRTree(const IndexedGraph<Graph>& g): edges_by_index(g.numEdges()), real_edges(g.numEdges()), home(g.numVertices(),{none,none}){
+			auto m = g.numEdges();
+			std::vector<Split> component;
+			for(auto&& e : g.edges()){
+				auto [u,v] = g.endpoints(e);
+				edges_by_index[g.index(e)] = e;
+				component.push_back({g.index(u),g.index(v),g.index(e)});
+			}
+
+			std::vector<std::pair<std::vector<Split>,NodeType>> finished;
+			size_t virtual_count = 0;
+			if(!component.empty())
+				split(std::move(component),g.numVertices(),m,virtual_count,finished);
+
+			merge(std::move(finished),m,virtual_count);
+			embedSkeletons();
+		}
+
+		auto numNodes() const -> size_t{
+			return nodes.size();
+		}
+
+		auto node(const size_t i) const -> const Node&{
+			return nodes[i];
+		}
+
+		/**
+		 * The node and the position in its skeleton of the edge with index e.
+		 */
+		auto skeletonEdge(const size_t e) const -> std::pair<size_t,size_t>{
+			return real_edges[e];
+		}
+
+		/**
+		 * Whether the graph is planar, i.e. all the R skeletons are.
+		 */
+		auto isPlanar() const -> bool{
+			return planar;
+		}
+
+		/**
+		 * The number of planar embeddings, counting mirror images, or the largest size_t if it overflows.
+		 */
+		auto numEmbeddings() const -> size_t{
+			if(!planar)
+				return 0;
+			size_t count = 1;
+			auto times = [&count](size_t k){
+				count = count > none/k ? none : count*k;
+			};
+			for(auto&& n : nodes){
+				if(n.type == NodeType::R)
+					times(2);
+				if(n.type == NodeType::P)
+					for(size_t k=2; k<n.edges.size(); k++)
+						times(k);
+			}
+			return count;
+		}
+
+		/**
+		 * Goes through the planar embeddings of the graph, as rotation systems, flipping one P-node order or R-node mirror at a time like an odometer.
+		 */
+		class EmbeddingIterator{
+
+			public:
+				EmbeddingIterator(const SPQRTree& tree): tree(&tree), orders(tree.nodes.size()), mirrored(tree.nodes.size(),false), done(!tree.planar){
+					for(size_t i=0; i<tree.nodes.size(); i++)
+						if(tree.nodes[i].type == NodeType::P){
+							orders[i].resize(tree.nodes[i].edges.size());
+							std::iota(orders[i].begin(),orders[i].end(),0);
+						}
+				}
+
+				auto operator*() const -> rotations_t<Graph>{
+					return tree->embedding(orders,mirrored);
+				}
+
+				auto operator++() -> EmbeddingIterator&{
+					for(size_t i=0; i<orders.size(); i++){
+						if(tree->nodes[i].type == NodeType::R){
+							mirrored[i] = !mirrored[i];
+							if(mirrored[i])
+								return *this;
+						}
+						//the first edge stays in place, since the orders are cyclic
+						if(tree->nodes[i].type == NodeType::P && orders[i].size() > 2)
+							if(std::next_permutation(orders[i].begin()+1,orders[i].end()))
+								return *this;
+					}
+					done = true;
+					return *this;
+				}
+
+				auto operator==(std::default_sentinel_t) const -> bool{
+					return done;
+				}
+
+			private:
+				const SPQRTree* tree;
+				std::vector<std::vector<size_t>> orders;
+				std::vector<bool> mirrored;
+				bool done;
+		};
+
+		struct Embeddings{
+			const SPQRTree* tree;
+
+			auto begin() const{
+				return EmbeddingIterator(*tree);
+			}
+
+			auto end() const{
+				return std::default_sentinel;
+			}
+		};
+
+		auto embeddings() const -> Embeddings{
+			return {this};
+		}
+
+		/**
+		 * The embedding with the given order of the skeleton edges of each P-node around its first vertex, and the given R-nodes mirrored.
+		 */
+		auto embedding(const std::vector<std::vector<size_t>>& orders, const std::vector<bool>& mirrored) const -> rotations_t<Graph>{
+			rotations_t<Graph> rotations(home.size());
+			for(size_t v=0; v<rotations.size(); v++)
+				if(home[v].first != none)
+					expand(home[v].first,home[v].second,orders,mirrored,rotations[v]);
+			return rotations;
+		}
+
+		/**
+		 * A planar embedding in which a new edge between the vertices with indices s and t crosses the fewest edges, over all the embeddings, and that number [8].
+		 * Only the R-nodes on the path of the tree from a node of s to the nearest node of t need crossings: the new edge goes along a shortest path in the dual of each skeleton,
+		 * from the faces at s or beside the virtual edge towards s, to the faces at t or beside the virtual edge towards t. Crossing any other virtual edge costs the fewest edges
+		 * that cross the part of the graph it stands for, whatever its embedding. The nodes on the path are then mirrored, and their bonds ordered, so that the paths meet at the virtual edges.
+		 * The graph must be planar, and the shortest paths take O(m log m) time.
+		 */
+		auto insertionEmbedding(const size_t s, const size_t t) const -> std::pair<rotations_t<Graph>,size_t>{
+			auto contains = [this](size_t i, size_t v){
+				return std::binary_search(nodes[i].vertices.begin(),nodes[i].vertices.end(),v);
+			};
+
+			//the path from a node of s to the nearest node of t, with a breadth first search from all the nodes of s
+			std::vector<size_t> parent(nodes.size(),none), queue;
+			std::vector<bool> seen(nodes.size(),false);
+			for(size_t i=0; i<nodes.size(); i++)
+				if(contains(i,s)){
+					seen[i] = true;
+					queue.push_back(i);
+				}
+			size_t last = none;
+			for(size_t q=0; q<queue.size() && last == none; q++){
+				if(contains(queue[q],t))
+					last = queue[q];
+				for(auto&& e : nodes[queue[q]].edges)
+					if(e.real == none && !seen[e.twin_node]){
+						seen[e.twin_node] = true;
+						parent[e.twin_node] = queue[q];
+						queue.push_back(e.twin_node);
+					}
+			}
+			std::vector<size_t> path{last};
+			while(parent[path.back()] != none)
+				path.push_back(parent[path.back()]);
+			std::reverse(path.begin(),path.end());
+
+			//the cost of crossing each node off the path, from the leaves towards the path, where `up` is its virtual edge towards the path
+			std::vector<size_t> cost(nodes.size(),0), up(nodes.size(),none), order(path);
+			std::fill(seen.begin(),seen.end(),false);
+			for(auto&& i : path)
+				seen[i] = true;
+			for(size_t q=0; q<order.size(); q++)
+				for(auto&& e : nodes[order[q]].edges)
+					if(e.real == none && !seen[e.twin_node]){
+						seen[e.twin_node] = true;
+						up[e.twin_node] = e.twin_edge;
+						order.push_back(e.twin_node);
+					}
+			auto weight = [&](size_t i, size_t p){
+				auto& e = nodes[i].edges[p];
+				return e.real != none ? 1 : cost[e.twin_node];
+			};
+
+			//the fewest crossings between the faces `from` and the faces `to` of node i, without crossing the blocked edges, and the faces where that path starts and ends
+			auto shortest = [&](size_t i, const std::vector<size_t>& face, const std::vector<size_t>& from, const std::vector<size_t>& to, size_t blocked_in, size_t blocked_out){
+				auto count = *std::max_element(face.begin(),face.end()) + 1;
+				std::vector<std::vector<std::pair<size_t,size_t>>> across(count);
+				for(size_t p=0; p<nodes[i].edges.size(); p++)
+					if(p != blocked_in && p != blocked_out){
+						across[face[2*p]].push_back({face[2*p+1],weight(i,p)});
+						across[face[2*p+1]].push_back({face[2*p],weight(i,p)});
+					}
+
+				std::vector<size_t> distance(count,none), origin(count,none);
+				std::priority_queue<std::pair<size_t,size_t>,std::vector<std::pair<size_t,size_t>>,std::greater<>> heap;
+				for(auto&& f : from)
+					if(distance[f] != 0){
+						distance[f] = 0;
+						origin[f] = f;
+						heap.push({0,f});
+					}
+				while(!heap.empty()){
+					auto [d,f] = heap.top();
+					heap.pop();
+					if(d > distance[f])
+						continue;
+					for(auto&& [h,w] : across[f])
+						if(d + w < distance[h]){
+							distance[h] = d + w;
+							origin[h] = origin[f];
+							heap.push({d + w,h});
+						}
+				}
+				auto end = *std::min_element(to.begin(),to.end(),[&distance](auto f, auto h){ return distance[f] < distance[h]; });
+				return std::make_tuple(distance[end],origin[end],end);
+			};
+
+			for(auto q=order.size(); q-- > path.size(); ){
+				auto i = order[q];
+				auto& node = nodes[i];
+				if(node.type == NodeType::R){
+					auto face = faces(i);
+					cost[i] = std::get<0>(shortest(i,face,{face[2*up[i]]},{face[2*up[i]+1]},up[i],none));
+					continue;
+				}
+				cost[i] = node.type == NodeType::S ? none : 0;
+				for(size_t p=0; p<node.edges.size(); p++)
+					if(p != up[i])
+						cost[i] = node.type == NodeType::S ? std::min(cost[i],weight(i,p)) : cost[i] + weight(i,p);
+			}
+
+			//the side of a skeleton edge with the corner before it around v
+			auto before = [this](size_t i, size_t p, size_t v) -> size_t{
+				return nodes[i].edges[p].u == v ? 0 : 1;
+			};
+
+			std::vector<std::vector<size_t>> orders(nodes.size());
+			std::vector<bool> mirrored(nodes.size(),false);
+			for(size_t i=0; i<nodes.size(); i++)
+				if(nodes[i].type == NodeType::P){
+					orders[i].resize(nodes[i].edges.size());
+					std::iota(orders[i].begin(),orders[i].end(),0);
+				}
+
+			//the virtual edges `in` and `out` lead to the previous and the next node, and the new edge arrives on the side `side` of `in` and leaves on the side `exit` of `out`
+			size_t crossings = 0, in = none, side = 0;
+			for(size_t k=0; k<path.size(); k++){
+				auto i = path[k];
+				auto& node = nodes[i];
+				size_t out = none, exit = 0;
+				if(k+1 < path.size())
+					for(size_t p=0; p<node.edges.size(); p++)
+						if(node.edges[p].real == none && node.edges[p].twin_node == path[k+1])
+							out = p;
+
+				if(node.type == NodeType::R){
+					auto face = faces(i);
+					std::vector<size_t> from, to;
+					auto around = [&](size_t v, std::vector<size_t>& ends){
+						for(auto&& p : rotations[i][local(i,v)])
+							ends.push_back(face[2*p + before(i,p,v)]);
+					};
+					if(in == none)
+						around(s,from);
+					else
+						from = {face[2*in],face[2*in+1]};
+					if(out == none)
+						around(t,to);
+					else
+						to = {face[2*out],face[2*out+1]};
+					auto [distance,start,end] = shortest(i,face,from,to,in,out);
+					crossings += distance;
+					if(in != none)
+						mirrored[i] = (start == face[2*in] ? 0 : 1) != side;
+					if(out != none)
+						exit = (end == face[2*out] ? 0 : 1) ^ mirrored[i];
+				}
+				else if(node.type == NodeType::S && in != none && out != none){
+					auto face = faces(i);
+					exit = face[2*out] == face[2*in+side] ? 0 : 1;
+				}
+				else if(node.type == NodeType::P && in != none && out != none){
+					//around the first pole, `out` goes right before `in` if the new edge arrives before `in`, and right after it otherwise
+					auto x = node.vertices[0];
+					auto arrives_before = side == before(i,in,x);
+					auto& bond = orders[i];
+					bond.assign(1,in);
+					if(!arrives_before)
+						bond.push_back(out);
+					for(size_t p=0; p<node.edges.size(); p++)
+						if(p != in && p != out)
+							bond.push_back(p);
+					if(arrives_before)
+						bond.push_back(out);
+					exit = arrives_before ? 1 - before(i,out,x) : before(i,out,x);
+				}
+
+				//the corner before an edge around a vertex is the one after its twin
+				if(out != none){
+					auto& e = node.edges[out];
+					auto& twin = nodes[e.twin_node].edges[e.twin_edge];
+					side = twin.u == e.u ? 1 - exit : exit;
+					in = e.twin_edge;
+				}
+			}
+
+			return {embedding(orders,mirrored),crossings};
+		}
+
+	private:
+		//an edge while splitting, where ids from m on are virtual edges
+		struct Split{
+			size_t u;
+			size_t v;
+			size_t id;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<edge_t<Graph>> edges_by_index;
+		std::vector<std::pair<size_t,size_t>> real_edges;
+		//a node containing each vertex, and the vertex position in it
+		std::vector<std::pair<size_t,size_t>> home;
+		//for S and R nodes, the skeleton edges around each local vertex
+		std::vector<std::vector<std::vector<size_t>>> rotations;
+		bool planar = true;
+
+		auto local(const size_t i, const size_t v) const -> size_t{
+			auto& vs = nodes[i].vertices;
+			return std::lower_bound(vs.begin(),vs.end(),v) - vs.begin();
+		}
+
+		//the face on each side of each skeleton edge of an S or R node, where side 0 of edge p is 2p and has the corner before p around its vertex u, and side 1 the corner after it
+		auto faces(const size_t i) const -> std::vector<size_t>{
+			auto& node = nodes[i];
+			std::vector<std::array<size_t,2>> at(node.edges.size());
+			for(size_t lv=0; lv<rotations[i].size(); lv++)
+				for(size_t k=0; k<rotations[i][lv].size(); k++){
+					auto p = rotations[i][lv][k];
+					at[p][node.edges[p].u == node.vertices[lv] ? 0 : 1] = k;
+				}
+
+			//the side leaving a vertex is followed by the side leaving the next vertex after the edge around it
+			std::vector<size_t> face(2*node.edges.size(),none);
+			size_t count = 0;
+			for(size_t d=0; d<face.size(); d++){
+				for(auto side=d; face[side] == none; ){
+					face[side] = count;
+					auto& e = node.edges[side/2];
+					auto v = side%2 == 0 ? e.v : e.u;
+					auto& r = rotations[i][local(i,v)];
+					auto p = r[(at[side/2][1 - side%2] + 1) % r.size()];
+					side = 2*p + (node.edges[p].u == v ? 0 : 1);
+				}
+				if(face[d] == count)
+					count++;
+			}
+			return face;
+		}
+
+		//the rotation of the skeleton edges around the local vertex `lv` of node i
+		auto rotation(const size_t i, const size_t lv, const std::vector<std::vector<size_t>>& orders, const std::vector<bool>& mirrored) const -> std::vector<size_t>{
+			if(nodes[i].type == NodeType::P){
+				if(lv == 0)
+					return orders[i];
+				return {orders[i].rbegin(),orders[i].rend()};
+			}
+			auto& r = rotations[i][lv];
+			if(mirrored[i])
+				return {r.rbegin(),r.rend()};
+			return r;
+		}
+
+		//appends the edges around the local vertex `lv` of node i, replacing each virtual edge by the edges after its twin around the same vertex,
+		//with a stack of the nodes being expanded, since the tree can be as deep as the graph is long
+		auto expand(const size_t i, const size_t lv, const std::vector<std::vector<size_t>>& orders, const std::vector<bool>& mirrored, std::vector<edge_t<Graph>>& out) const -> void{
+			struct Frame{
+				size_t node;
+				size_t v;
+				std::vector<size_t> r;
+				size_t next;
+				size_t count;
+			};
+			auto frame = [&](size_t i, size_t lv, size_t after){
+				auto r = rotation(i,lv,orders,mirrored);
+				size_t next = 0, count = r.size();
+				if(after != none){
+					next = std::find(r.begin(),r.end(),after) - r.begin() + 1;
+					count--;
+				}
+				return Frame{i,nodes[i].vertices[lv],std::move(r),next,count};
+			};
+
+			std::vector<Frame> stack{frame(i,lv,none)};
+			while(!stack.empty()){
+				auto& f = stack.back();
+				if(f.count == 0){
+					stack.pop_back();
+					continue;
+				}
+				auto& e = nodes[f.node].edges[f.r[f.next++ % f.r.size()]];
+				f.count--;
+				if(e.real != none)
+					out.push_back(edges_by_index[e.real]);
+				else
+					stack.push_back(frame(e.twin_node,local(e.twin_node,f.v),e.twin_edge));
+			}
+		}
+
+		//splits off every multiple edge as a bond and every separation pair as it is found, in the path search of Hopcroft and Tarjan [6] with the corrections of Gutwenger and Mutzel [7]
+		static auto split(std::vector<Split> c, const size_t n, const size_t m, size_t& virtual_count, std::vector<std::pair<std::vector<Split>,NodeType>>& finished) -> void{
+			//the edges are bucket sorted by their endpoints, so that multiple edges are consecutive
+			auto bucketSort = [n](std::vector<Split>& c, auto key){
+				std::vector<size_t> count(n+1,0);
+				for(auto&& e : c)
+					count[key(e)+1]++;
+				for(size_t v=0; v<n; v++)
+					count[v+1] += count[v];
+				std::vector<Split> sorted(c.size());
+				for(auto&& e : c)
+					sorted[count[key(e)]++] = e;
+				c = std::move(sorted);
+			};
+			bucketSort(c,[](auto& e){ return std::max(e.u,e.v); });
+			bucketSort(c,[](auto& e){ return std::min(e.u,e.v); });
+			if(std::minmax(c.front().u,c.front().v) == std::minmax(c.back().u,c.back().v)){
+				finished.push_back({std::move(c),NodeType::P});
+				return;
+			}
+
+			//the arcs while searching, where the graph keeps the virtual edge of each bond
+			enum class Arc{unseen,tree,frond};
+			std::vector<size_t> source, target, id;
+			std::vector<Arc> type;
+			for(size_t i=0,j=0; i<c.size(); i=j){
+				while(j < c.size() && std::minmax(c[j].u,c[j].v) == std::minmax(c[i].u,c[i].v))
+					j++;
+				source.push_back(c[i].u);
+				target.push_back(c[i].v);
+				if(j-i == 1){
+					id.push_back(c[i].id);
+					continue;
+				}
+				id.push_back(m + virtual_count++);
+				std::vector<Split> bond(c.begin()+i,c.begin()+j);
+				bond.push_back({c[i].u,c[i].v,id.back()});
+				finished.push_back({std::move(bond),NodeType::P});
+			}
+			type.assign(source.size(),Arc::unseen);
+
+			std::vector<std::vector<size_t>> incident(n);
+			for(size_t e=0; e<source.size(); e++){
+				incident[source[e]].push_back(e);
+				incident[target[e]].push_back(e);
+			}
+			auto arcs = [&](auto&& component){
+				std::vector<Split> edges;
+				for(auto&& e : component)
+					edges.push_back({source[e],target[e],id[e]});
+				return edges;
+			};
+			if(std::all_of(incident.begin(),incident.end(),[](auto& a){ return a.size() == 2; })){
+				std::vector<size_t> all(source.size());
+				std::iota(all.begin(),all.end(),0);
+				finished.push_back({arcs(all),NodeType::S});
+				return;
+			}
+
+			//a palm tree from vertex 0 with preorder numbers from 1: the tree arcs go to the children and the fronds to the ancestors
+			std::vector<size_t> number(n,0), father(n,none), low1(n), low2(n), nd(n,1), tree_arc(n,none), next(n,0);
+			std::vector<size_t> stack{0};
+			size_t count = 1;
+			number[0] = low1[0] = low2[0] = count;
+			while(!stack.empty()){
+				auto v = stack.back();
+				if(next[v] < incident[v].size()){
+					auto e = incident[v][next[v]++];
+					if(type[e] != Arc::unseen)
+						continue;
+					auto w = source[e] != v ? source[e] : target[e];
+					source[e] = v;
+					target[e] = w;
+					if(number[w] == 0){
+						type[e] = Arc::tree;
+						tree_arc[w] = e;
+						father[w] = v;
+						number[w] = low1[w] = low2[w] = ++count;
+						stack.push_back(w);
+					}
+					else{
+						type[e] = Arc::frond;
+						if(number[w] < low1[v]){
+							low2[v] = low1[v];
+							low1[v] = number[w];
+						}
+						else if(number[w] > low1[v])
+							low2[v] = std::min(low2[v],number[w]);
+					}
+					continue;
+				}
+				stack.pop_back();
+				if(auto u = father[v]; u != none){
+					if(low1[v] < low1[u]){
+						low2[u] = std::min(low1[u],low2[v]);
+						low1[u] = low1[v];
+					}
+					else if(low1[v] == low1[u])
+						low2[u] = std::min(low2[u],low2[v]);
+					else
+						low2[u] = std::min(low2[u],low1[v]);
+					nd[u] += nd[v];
+				}
+			}
+
+			//the arcs are bucket sorted by phi, so that paths reach the lowest vertices first
+			std::vector<std::vector<size_t>> buckets(3*n+3);
+			for(size_t e=0; e<source.size(); e++){
+				auto v = source[e], w = target[e];
+				auto phi = type[e] == Arc::frond ? 3*number[w] + 1 : 3*low1[w] + (low2[w] < number[v] ? 0 : 2);
+				buckets[phi].push_back(e);
+			}
+			std::vector<std::list<size_t>> adjacent(n);
+			std::vector<std::list<size_t>::iterator> in_adjacent(source.size());
+			for(auto&& bucket : buckets)
+				for(auto&& e : bucket)
+					in_adjacent[e] = adjacent[source[e]].insert(adjacent[source[e]].end(),e);
+
+			//the vertices are renumbered so that the children of each vertex have decreasing numbers, each arc is marked if it starts a path,
+			//and the fronds into each vertex are listed by the new number of their source in the order they are visited
+			std::vector<size_t> newnum(n), nodeat(n+1), degree(n);
+			std::vector<bool> starts(source.size(),false), has_high(source.size(),false);
+			std::vector<std::list<size_t>> highpt(n);
+			std::vector<std::list<size_t>::iterator> in_high(source.size());
+			count = n;
+			newnum[0] = count - nd[0] + 1;
+			bool new_path = true;
+			std::vector<std::pair<size_t,std::list<size_t>::iterator>> visit{{0,adjacent[0].begin()}};
+			while(!visit.empty()){
+				auto [v,it] = visit.back();
+				if(it == adjacent[v].end()){
+					visit.pop_back();
+					if(!visit.empty()){
+						count--;
+						++visit.back().second;
+					}
+					continue;
+				}
+				auto e = *it, w = target[e];
+				if(new_path){
+					new_path = false;
+					starts[e] = true;
+				}
+				if(type[e] == Arc::tree){
+					newnum[w] = count - nd[w] + 1;
+					visit.push_back({w,adjacent[w].begin()});
+					continue;
+				}
+				in_high[e] = highpt[w].insert(highpt[w].end(),newnum[v]);
+				has_high[e] = true;
+				new_path = true;
+				++visit.back().second;
+			}
+			std::vector<size_t> renumber(n+1);
+			for(size_t v=0; v<n; v++){
+				renumber[number[v]] = newnum[v];
+				nodeat[newnum[v]] = v;
+				degree[v] = incident[v].size();
+			}
+			for(size_t v=0; v<n; v++){
+				low1[v] = renumber[low1[v]];
+				low2[v] = renumber[low2[v]];
+			}
+
+			auto newArc = [&](size_t v, size_t w, Arc a){
+				source.push_back(v);
+				target.push_back(w);
+				id.push_back(m + virtual_count++);
+				type.push_back(a);
+				starts.push_back(false);
+				has_high.push_back(false);
+				in_adjacent.emplace_back();
+				in_high.emplace_back();
+				return source.size() - 1;
+			};
+			auto high = [&](size_t v) -> size_t{
+				return highpt[v].empty() ? 0 : highpt[v].front();
+			};
+			auto deleteHigh = [&](size_t e){
+				if(has_high[e]){
+					highpt[target[e]].erase(in_high[e]);
+					has_high[e] = false;
+				}
+			};
+
+			//the triples (h,a,b) of possible type-2 pairs {a,b}, where h is the highest vertex between them, and a = 0 ends a path
+			struct Triple{
+				size_t h;
+				size_t a;
+				size_t b;
+			};
+			std::vector<Triple> triples{{0,0,0}};
+			//a new path to `low` replaces the triples above it by one, whose h is at least `floor`
+			auto pushPath = [&triples](size_t h, size_t floor, size_t low, size_t b){
+				bool deleted = false;
+				size_t y = 0, last = 0;
+				while(triples.back().a > low){
+					y = std::max(y,triples.back().h);
+					last = triples.back().b;
+					triples.pop_back();
+					deleted = true;
+				}
+				if(deleted)
+					triples.push_back({std::max(y,floor),low,last});
+				else
+					triples.push_back({h,low,b});
+			};
+
+			//the visited arcs that are not split off yet, and the split components as arcs
+			std::vector<size_t> visited;
+			std::vector<std::pair<std::vector<size_t>,NodeType>> components;
+
+			struct Frame{
+				size_t v;
+				std::list<size_t>::iterator it;
+				std::list<size_t>::iterator next;
+				//the tree arc to the child being searched, and the arcs out of v when it was reached
+				size_t arc;
+				size_t outdegree;
+			};
+			std::vector<Frame> frames{{0,adjacent[0].begin(),{},none,adjacent[0].size()}};
+			while(!frames.empty()){
+				auto& f = frames.back();
+				if(f.it != adjacent[f.v].end()){
+					auto vnum = newnum[f.v];
+					auto e = *f.it, w = target[e];
+					f.next = std::next(f.it);
+					if(type[e] == Arc::tree){
+						if(starts[e]){
+							pushPath(newnum[w] + nd[w] - 1,newnum[w] + nd[w] - 1,low1[w],vnum);
+							triples.push_back({0,0,0});
+						}
+						f.arc = e;
+						frames.push_back({w,adjacent[w].begin(),{},none,adjacent[w].size()});
+						continue;
+					}
+					if(starts[e])
+						pushPath(vnum,0,newnum[w],vnum);
+					visited.push_back(e);
+					f.it = f.next;
+					continue;
+				}
+				auto w = f.v;
+				frames.pop_back();
+				if(frames.empty())
+					break;
+
+				//back at v from the tree arc e to w
+				auto& parent = frames.back();
+				auto v = parent.v, vnum = newnum[v], wnum = newnum[w];
+				auto e = parent.arc, it = parent.it;
+				visited.push_back(tree_arc[w]);
+
+				//type-2 pairs {v,b}, either from a triple or from w with degree 2 and a child b
+				while(vnum != 1){
+					auto a = triples.back().a, b = triples.back().b;
+					auto child = adjacent[w].empty() ? none : target[adjacent[w].front()];
+					auto chain = degree[w] == 2 && child != none && newnum[child] > wnum;
+					if(a != vnum && !chain)
+						break;
+					if(a == vnum && father[nodeat[b]] == nodeat[a]){
+						triples.pop_back();
+						continue;
+					}
+
+					size_t e_ab = none, virt, x;
+					if(chain){
+						auto e1 = visited.back();
+						visited.pop_back();
+						auto e2 = visited.back();
+						visited.pop_back();
+						adjacent[w].erase(in_adjacent[e2]);
+						x = target[e2];
+						virt = newArc(v,x,Arc::tree);
+						degree[x]--;
+						degree[v]--;
+						components.push_back({{e1,e2,virt},NodeType::S});
+						if(!visited.empty() && source[visited.back()] == x && target[visited.back()] == v){
+							e_ab = visited.back();
+							visited.pop_back();
+							adjacent[x].erase(in_adjacent[e_ab]);
+							deleteHigh(e_ab);
+						}
+					}
+					else{
+						auto h = triples.back().h;
+						triples.pop_back();
+						std::vector<size_t> component;
+						while(!visited.empty()){
+							auto xy = visited.back();
+							auto xn = newnum[source[xy]], yn = newnum[target[xy]];
+							if(xn < a || xn > h || yn < a || yn > h)
+								break;
+							visited.pop_back();
+							if(std::minmax(xn,yn) == std::minmax(a,b)){
+								e_ab = xy;
+								adjacent[source[xy]].erase(in_adjacent[xy]);
+								deleteHigh(xy);
+								continue;
+							}
+							if(*it != xy){
+								adjacent[source[xy]].erase(in_adjacent[xy]);
+								deleteHigh(xy);
+							}
+							component.push_back(xy);
+							degree[source[xy]]--;
+							degree[target[xy]]--;
+						}
+						x = nodeat[b];
+						virt = newArc(v,x,Arc::tree);
+						component.push_back(virt);
+						components.push_back({std::move(component),NodeType::R});
+					}
+
+					if(e_ab != none){
+						auto bond = newArc(v,x,Arc::tree);
+						components.push_back({{e_ab,virt,bond},NodeType::P});
+						virt = bond;
+						degree[x]--;
+						degree[v]--;
+					}
+					visited.push_back(virt);
+					*it = virt;
+					in_adjacent[virt] = it;
+					degree[x]++;
+					degree[v]++;
+					father[x] = v;
+					tree_arc[x] = virt;
+					w = x;
+					wnum = newnum[w];
+				}
+
+				//a type-1 pair {low1(w),v}, where the subtree of w only reaches low1(w) and v, and something else is left
+				if(low2[w] >= vnum && low1[w] < vnum && (father[v] != 0 || parent.outdegree >= 2)){
+					std::vector<size_t> component;
+					size_t xn = 0, yn = 0;
+					while(!visited.empty()){
+						auto xy = visited.back();
+						xn = newnum[source[xy]];
+						yn = newnum[target[xy]];
+						if((xn < wnum || xn >= wnum + nd[w]) && (yn < wnum || yn >= wnum + nd[w]))
+							break;
+						visited.pop_back();
+						component.push_back(xy);
+						deleteHigh(xy);
+						degree[source[xy]]--;
+						degree[target[xy]]--;
+					}
+					auto low = nodeat[low1[w]];
+					auto virt = newArc(v,low,Arc::frond);
+					component.push_back(virt);
+					components.push_back({std::move(component),NodeType::R});
+
+					if(!visited.empty() && std::minmax(xn,yn) == std::minmax(vnum,low1[w])){
+						auto eh = visited.back();
+						visited.pop_back();
+						if(*it != eh)
+							adjacent[source[eh]].erase(in_adjacent[eh]);
+						auto bond = newArc(v,low,Arc::frond);
+						components.push_back({{eh,virt,bond},NodeType::P});
+						in_high[bond] = in_high[eh];
+						has_high[bond] = has_high[eh];
+						has_high[eh] = false;
+						virt = bond;
+						degree[v]--;
+						degree[low]--;
+					}
+
+					if(low != father[v]){
+						visited.push_back(virt);
+						*it = virt;
+						in_adjacent[virt] = it;
+						if(!has_high[virt] && high(low) < vnum){
+							in_high[virt] = highpt[low].insert(highpt[low].begin(),vnum);
+							has_high[virt] = true;
+						}
+						degree[v]++;
+						degree[low]++;
+					}
+					else{
+						//the new frond is parallel to the tree arc into v
+						adjacent[v].erase(it);
+						deleteHigh(virt);
+						auto arc = newArc(low,v,Arc::tree);
+						auto eh = tree_arc[v];
+						components.push_back({{virt,arc,eh},NodeType::P});
+						tree_arc[v] = arc;
+						in_adjacent[arc] = in_adjacent[eh];
+						*in_adjacent[eh] = arc;
+					}
+				}
+
+				if(starts[e]){
+					while(triples.back().a != 0)
+						triples.pop_back();
+					triples.pop_back();
+				}
+				while(triples.back().a != 0 && triples.back().a != vnum && triples.back().b != vnum && high(v) > triples.back().h)
+					triples.pop_back();
+				parent.outdegree--;
+				parent.it = parent.next;
+			}
+			components.push_back({std::move(visited),NodeType::R});
+
+			//what is left of a triconnected component is a cycle when all its vertices have degree 2
+			std::vector<size_t> local_degree(n,0);
+			for(auto&& [component,t] : components){
+				if(t == NodeType::R){
+					for(auto&& e : component){
+						local_degree[source[e]]++;
+						local_degree[target[e]]++;
+					}
+					if(std::all_of(component.begin(),component.end(),[&](auto e){ return local_degree[source[e]] == 2 && local_degree[target[e]] == 2; }))
+						t = NodeType::S;
+					for(auto&& e : component)
+						local_degree[source[e]] = local_degree[target[e]] = 0;
+				}
+				finished.push_back({arcs(component),t});
+			}
+		}
+
+		//merges adjacent cycles and adjacent bonds and builds the nodes
+		auto merge(std::vector<std::pair<std::vector<Split>,NodeType>> finished, const size_t m, const size_t virtual_count) -> void{
+			std::vector<std::array<size_t,2>> owners(virtual_count,{none,none});
+			for(size_t i=0; i<finished.size(); i++)
+				for(auto&& e : finished[i].first)
+					if(e.id >= m)
+						owners[e.id-m][owners[e.id-m][0] == none ? 0 : 1] = i;
+
+			std::vector<size_t> group(finished.size());
+			std::iota(group.begin(),group.end(),0);
+			auto find = [&group](size_t i){
+				while(group[i] != i)
+					i = group[i] = group[group[i]];
+				return i;
+			};
+
+			std::vector<bool> removed(virtual_count,false);
+			for(size_t k=0; k<virtual_count; k++){
+				auto [i,j] = owners[k];
+				if(finished[i].second == finished[j].second && finished[i].second != NodeType::R){
+					removed[k] = true;
+					group[find(i)] = find(j);
+				}
+			}
+
+			std::vector<size_t> node_of(finished.size(),none);
+			for(size_t i=0; i<finished.size(); i++){
+				auto r = find(i);
+				if(node_of[r] == none){
+					node_of[r] = nodes.size();
+					nodes.push_back(Node{finished[r].second,{},{}});
+				}
+				auto& node = nodes[node_of[r]];
+				for(auto&& e : finished[i].first)
+					if(e.id < m || !removed[e.id-m])
+						node.edges.push_back({e.u,e.v,e.id < m ? e.id : none,none,e.id < m ? none : e.id-m});
+			}
+
+			std::vector<std::pair<size_t,size_t>> first_side(virtual_count,{none,none});
+			for(size_t i=0; i<nodes.size(); i++){
+				auto& node = nodes[i];
+				for(size_t p=0; p<node.edges.size(); p++){
+					auto& e = node.edges[p];
+					node.vertices.push_back(e.u);
+					node.vertices.push_back(e.v);
+					if(e.real != none){
+						real_edges[e.real] = {i,p};
+						continue;
+					}
+					auto k = e.twin_edge;
+					if(first_side[k].first == none)
+						first_side[k] = {i,p};
+					else{
+						auto [j,q] = first_side[k];
+						e.twin_node = j;
+						e.twin_edge = q;
+						nodes[j].edges[q].twin_node = i;
+						nodes[j].edges[q].twin_edge = p;
+					}
+				}
+				std::sort(node.vertices.begin(),node.vertices.end());
+				node.vertices.erase(std::unique(node.vertices.begin(),node.vertices.end()),node.vertices.end());
+				for(size_t lv=0; lv<node.vertices.size(); lv++)
+					home[node.vertices[lv]] = {i,lv};
+			}
+		}
+
+		//the rotations of the cycles, and an embedding of each triconnected skeleton
+		auto embedSkeletons() -> void{
+			using Skeleton = boost::adjacency_list<boost::vecS,boost::vecS,boost::undirectedS,boost::no_property,boost::property<boost::edge_index_t,size_t>>;
+
+			rotations.resize(nodes.size());
+			for(size_t i=0; i<nodes.size(); i++){
+				auto& node = nodes[i];
+				rotations[i].resize(node.vertices.size());
+				if(node.type == NodeType::S){
+					for(size_t p=0; p<node.edges.size(); p++){
+						rotations[i][local(i,node.edges[p].u)].push_back(p);
+						rotations[i][local(i,node.edges[p].v)].push_back(p);
+					}
+				}
+				if(node.type != NodeType::R)
+					continue;
+
+				Skeleton skeleton(node.vertices.size());
+				for(size_t p=0; p<node.edges.size(); p++)
+					add_edge(local(i,node.edges[p].u),local(i,node.edges[p].v),p,skeleton);
+
+				std::vector<std::vector<typename boost::graph_traits<Skeleton>::edge_descriptor>> embedding(node.vertices.size());
+				planar = planar && boyer_myrvold_planarity_test(
+						boost::boyer_myrvold_params::graph = skeleton
+						,boost::boyer_myrvold_params::embedding = make_iterator_property_map(embedding.begin(),get(boost::vertex_index,skeleton))
+						);
+				if(!planar)
+					continue;
+
+				auto index = get(boost::edge_index,skeleton);
+				for(size_t lv=0; lv<embedding.size(); lv++)
+					for(auto&& e : embedding[lv])
+						rotations[i][lv].push_back(boost::get(index,e));
+			}
+		}
+};
+
+}//namespace
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <ranges>
 #include <optional>
+#include <random>
 
 #include <boost/graph/random_spanning_tree.hpp>
 #include <boost/random/mersenne_twister.hpp>
@@ -15,6 +16,18 @@
 
 namespace gdraw{
 
+/**
+ * Seed type of the random number generators used in the library.
+ */
+using seed_t = boost::mt19937::result_type;
+
+/**
+ * Returns a non-deterministic seed. Used as default whenever a seed is not given.
+ */
+inline auto randomSeed() -> seed_t{
+	return std::random_device{}();
+}
+
 //TODO maybe use parallel for each? : std::for_each(std::execution::par_unseq,...
 /*
  * Executes `execute` for each subset of collection with size between `min_size` and `max_size` until it returns `true`.
@@ -409,18 +422,18 @@ auto bridges(const IndexedGraph<Graph>& g, const std::vector<edge_t<Graph>>& sub
 }
 
 /*
- * Returns a random spanning tree of g.
+ * Returns a random spanning tree of g. The same `seed` always yields the same tree.
  *
  * It is just a wrapper around Boost's function.
  */
 template<template<typename> typename Wrapper,typename Graph>
 requires AsGraphWrapper<Wrapper,Graph>
-std::vector<edge_t<Graph>> randomSpanningTree(const Wrapper<Graph>& g){	
+std::vector<edge_t<Graph>> randomSpanningTree(const Wrapper<Graph>& g, seed_t seed = randomSeed()){	
 
 	std::vector<vertex_t<Graph>> parent(num_vertices(g.getGraph()),boost::graph_traits<Graph>::null_vertex());
 	std::vector<edge_t<Graph>> tree_edges;
 
-	boost::mt19937 gen(time(0));
+	boost::mt19937 gen(seed);
 	boost::random_spanning_tree(g.getGraph(),gen,boost::predecessor_map(&parent[0]));
 
 	//auto root = *(vertices(g.getGraph())).first;
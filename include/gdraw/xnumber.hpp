@@ -2,10 +2,21 @@
 
 #include <iostream>
 #include <variant>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <array>
+#include <limits>
+#include <algorithm>
+
+#include <boost/graph/biconnected_components.hpp>
 
 #include <gdraw/graph_types.hpp>
 #include <gdraw/util.hpp>
 #include <gdraw/planar_graphs.hpp>
+#include <gdraw/pplane.hpp>
+#include <gdraw/embedded_graphs.hpp>
+#include <gdraw/spqr_tree.hpp>
 
 /**
  * Removes isolated vertices (i.e. degree 0) from the graph.
@@ -154,6 +165,510 @@ auto planarXNumberRecursion(IndexedGraph<Graph>& g, size_t k, std::vector<edge_t
 }
 
 
+/**
+ * The cheapest way to draw a new edge s-t in a fixed embedding: a corner of s, given by a face and the position in its walk of the side leaving s,
+ * the sides crossed, each on the face before the crossing, and the corner of t on the last face.
+ */
+struct InsertionPath{
+	size_t s_face;
+	size_t s_position;
+	size_t t_face;
+	size_t t_position;
+	std::vector<size_t> sides;
+};
+
+/**
+ * Finds an InsertionPath for s-t with a breadth first search in the dual of `g`, from the faces at s to the first face at t. Takes linear time.
+ * A corner is the side that leaves its vertex when the face is walked along the rotations.
+ *
+ * @return : The path, or nothing if every path crosses at least `bound` sides, in which case the search stops there.
+ */
+template <typename Graph>
+auto insertionPath(const PlanarGraph<Graph>& g, const DualGraph& dual, const std::vector<edge_t<Graph>>& edges_by_index, const size_t s, const size_t t, const size_t bound = std::numeric_limits<size_t>::max()) -> std::optional<InsertionPath>{
+	//with positive signals, side 0 leaves the endpoint with the smaller index
+	auto leaving = [&](size_t side){
+		auto [a,b] = g.endpoints(edges_by_index[side/2]);
+		return side%2 == 0 ? std::min(g.index(a),g.index(b)) : std::max(g.index(a),g.index(b));
+	};
+	auto corner = [&](size_t f, size_t v) -> std::optional<size_t>{
+		auto walk = dual.face(f);
+		for(size_t k=0; k<walk.size(); k++)
+			if(leaving(walk[k]) == v)
+				return k;
+		return {};
+	};
+
+	const size_t none = std::numeric_limits<size_t>::max();
+	std::vector<size_t> parent_side(dual.numFaces(),none), depth(dual.numFaces(),none);
+	std::vector<size_t> queue;
+	for(size_t f=0; f<dual.numFaces(); f++)
+		if(corner(f,s)){
+			depth[f] = 0;
+			queue.push_back(f);
+		}
+
+	InsertionPath path;
+	path.t_face = none;
+	for(size_t q=0; q<queue.size() && path.t_face == none; q++){
+		auto f = queue[q];
+		if(depth[f] >= bound)
+			break;
+		if(auto k = corner(f,t)){
+			path.t_face = f;
+			path.t_position = *k;
+			break;
+		}
+		for(auto&& side : dual.face(f)){
+			auto h = dual.across(side);
+			if(depth[h] == none){
+				depth[h] = depth[f] + 1;
+				parent_side[h] = side;
+				queue.push_back(h);
+			}
+		}
+	}
+	if(path.t_face == none)
+		return {};
+
+	auto f = path.t_face;
+	while(parent_side[f] != none){
+		auto side = parent_side[f];
+		path.sides.push_back(side);
+		f = dual.endpoints(side/2)[side%2];
+	}
+	std::reverse(path.sides.begin(),path.sides.end());
+	path.s_face = f;
+	path.s_position = *corner(f,s);
+	return path;
+}
+
+/**
+ * The position in the rotation of v of the edge arriving at the corner of v at position k of the walk of face f, so an edge drawn in that corner goes right after it.
+ */
+template <typename Graph>
+auto cornerPosition(const PlanarGraph<Graph>& g, const DualGraph& dual, const std::vector<edge_t<Graph>>& edges_by_index, const size_t f, const size_t k, const size_t v) -> size_t{
+	auto walk = dual.face(f);
+	auto previous = dual.isPositive(f) ? k + walk.size() - 1 : k + 1;
+	auto arriving = edges_by_index[walk[previous%walk.size()]/2];
+	auto& r = g.rotations[v];
+	return std::find(r.begin(),r.end(),arriving) - r.begin();
+}
+
+/**
+ * Inserts a new edge s-t into the plane graph `g` along the path found by insertionPath. Each crossing is a new vertex,
+ * with the two halves of each crossing edge two apart in its rotation, as drawFlattenedGraph expects.
+ * The first piece of the new edge gets the index numEdges(), and the crossed edges keep their indices on the piece at the start of the crossed side.
+ *
+ * @return : The planarization and the number of crossings.
+ */
+template <typename Graph>
+auto insertEdge(PlanarGraph<Graph> g, const size_t s, const size_t t) -> std::pair<PlanarGraph<Graph>,size_t>{
+	auto m = g.numEdges();
+	std::vector<edge_t<Graph>> edges_by_index(m);
+	for(auto&& e : g.edges())
+		edges_by_index[g.index(e)] = e;
+
+	auto dual = dualGraph(g);
+	auto path = insertionPath(g,dual,edges_by_index,s,t).value();
+
+	//the new edge goes right after the edge arriving at each corner, found before the rotations change
+	auto s_corner = cornerPosition(g,dual,edges_by_index,path.s_face,path.s_position,s);
+	auto t_corner = cornerPosition(g,dual,edges_by_index,path.t_face,path.t_position,t);
+
+	auto replace = [&g](size_t v, edge_t<Graph> e, edge_t<Graph> f){
+		auto& r = g.rotations[v];
+		*std::find(r.begin(),r.end(),e) = f;
+	};
+
+	size_t ecount = m+1;
+	std::vector<vertex_t<Graph>> chain{g.vertex(s)};
+	std::vector<std::array<edge_t<Graph>,2>> halves;
+	for(auto&& side : path.sides){
+		auto e = edges_by_index[side/2];
+		auto [a,b] = g.endpoints(e);
+		if(g.index(b) < g.index(a))
+			std::swap(a,b);
+		auto u = side%2 == 0 ? a : b;
+		auto w = side%2 == 0 ? b : a;
+
+		auto d = g.addVertex();
+		g.rotations.emplace_back();
+		g.removeEdge(e);
+		auto du = g.addEdge(d,u,side/2);
+		auto dw = g.addEdge(d,w,ecount++);
+		replace(g.index(u),e,du);
+		replace(g.index(w),e,dw);
+
+		chain.push_back(d);
+		halves.push_back({du,dw});
+	}
+	chain.push_back(g.vertex(t));
+
+	std::vector<edge_t<Graph>> links;
+	for(size_t j=0; j+1<chain.size(); j++)
+		links.push_back(g.addEdge(chain[j],chain[j+1],j == 0 ? m : ecount++));
+
+	//the side crossed is walked from u to w, so the link on its face comes right after d-u
+	for(size_t j=0; j<halves.size(); j++)
+		g.rotations[g.index(chain[j+1])] = {halves[j][0],links[j],halves[j][1],links[j+1]};
+	g.rotations[s].insert(g.rotations[s].begin() + s_corner + 1,links.front());
+	g.rotations[t].insert(g.rotations[t].begin() + t_corner + 1,links.back());
+	g.edge_signals.resize(ecount,1);
+
+	return {std::move(g),path.sides.size()};
+}
+
+/**
+ * A planarization of a graph with one edge inserted into a planar subgraph, the number of crossings, and whether it is the crossing number.
+ */
+template <typename Graph>
+struct EdgeInsertion{
+	PlanarGraph<Graph> planarization;
+	size_t crossings;
+	bool exact;
+};
+
+/**
+ * An embedding of the plane graph `g` in which a new edge s-t crosses the fewest edges, over all the embeddings of g, and that number [8].
+ * Each block on the way from s to t gets the embedding of SPQRTree::insertionEmbedding between the vertices where the way enters and leaves it,
+ * and at each cut vertex on the way the next block goes into the corner where the new edge leaves the previous one, so the crossings add up.
+ * The other blocks keep their embedding in `g`. Takes O(m log m) time.
+ *
+ * @return : The rotations and the number of crossings, or nothing if s and t are not connected.
+ */
+template <typename Graph>
+auto insertionEmbedding(const PlanarGraph<Graph>& g, const size_t s, const size_t t) -> std::optional<std::pair<rotations_t<Graph>,size_t>>{
+	const size_t none = std::numeric_limits<size_t>::max();
+	auto n = g.numVertices();
+	auto m = g.numEdges();
+	std::vector<edge_t<Graph>> edges_by_index(m);
+	for(auto&& e : g.edges())
+		edges_by_index[g.index(e)] = e;
+
+	std::vector<size_t> block(m);
+	auto blocks = boost::biconnected_components(g.getGraph(),make_iterator_property_map(block.begin(),get(boost::edge_index,g.getGraph())));
+	std::vector<std::vector<size_t>> block_edges(blocks), block_vertices(blocks), vertex_blocks(n);
+	for(size_t i=0; i<m; i++)
+		block_edges[block[i]].push_back(i);
+	std::vector<size_t> mark(n,none);
+	for(size_t b=0; b<blocks; b++)
+		for(auto&& i : block_edges[b]){
+			auto [x,y] = g.endpoints(edges_by_index[i]);
+			for(auto&& v : {g.index(x),g.index(y)})
+				if(mark[v] != b){
+					mark[v] = b;
+					block_vertices[b].push_back(v);
+					vertex_blocks[v].push_back(b);
+				}
+		}
+
+	//the way from s to t through the blocks and the cut vertices, with a breadth first search
+	std::vector<size_t> from_block(n,none), from_vertex(blocks,none), queue{s};
+	std::vector<bool> reached(n,false), entered(blocks,false);
+	reached[s] = true;
+	for(size_t q=0; q<queue.size() && !reached[t]; q++)
+		for(auto&& b : vertex_blocks[queue[q]])
+			if(!entered[b]){
+				entered[b] = true;
+				from_vertex[b] = queue[q];
+				for(auto&& w : block_vertices[b])
+					if(!reached[w]){
+						reached[w] = true;
+						from_block[w] = b;
+						queue.push_back(w);
+					}
+			}
+	if(!reached[t])
+		return {};
+	std::vector<std::array<size_t,3>> way;
+	for(auto v=t; v!=s; v=from_vertex[from_block[v]])
+		way.push_back({from_block[v],from_vertex[from_block[v]],v});
+	std::reverse(way.begin(),way.end());
+
+	//the blocks on the way, each rotated so that its rotations at the vertices where the way enters and leaves it end at the corner of the new edge
+	rotations_t<Graph> rotations(n);
+	std::vector<bool> on_way(blocks,false);
+	std::vector<size_t> local(n);
+	size_t crossings = 0;
+	for(auto&& [b,u,w] : way){
+		on_way[b] = true;
+		auto& vertices = block_vertices[b];
+		auto& edges = block_edges[b];
+		for(size_t k=0; k<vertices.size(); k++)
+			local[vertices[k]] = k;
+		IndexedGraph<Graph> h{Graph(vertices.size())};
+		for(size_t k=0; k<edges.size(); k++){
+			auto [x,y] = g.endpoints(edges_by_index[edges[k]]);
+			h.addEdge(h.vertex(local[g.index(x)]),h.vertex(local[g.index(y)]),k);
+		}
+		auto embedding = SPQRTree<Graph>(h).insertionEmbedding(local[u],local[w]).first;
+		auto pg = PlanarGraph<Graph>(std::move(h),std::move(embedding),std::vector<int>(edges.size(),1));
+
+		std::vector<edge_t<Graph>> block_by_index(edges.size());
+		for(auto&& e : pg.edges())
+			block_by_index[pg.index(e)] = e;
+		auto dual = dualGraph(pg);
+		auto path = insertionPath(pg,dual,block_by_index,local[u],local[w]).value();
+		crossings += path.sides.size();
+
+		std::vector<size_t> shift(vertices.size(),0);
+		shift[local[u]] = cornerPosition(pg,dual,block_by_index,path.s_face,path.s_position,local[u]) + 1;
+		shift[local[w]] = cornerPosition(pg,dual,block_by_index,path.t_face,path.t_position,local[w]) + 1;
+		for(size_t k=0; k<vertices.size(); k++){
+			auto& r = pg.rotations[k];
+			for(size_t j=0; j<r.size(); j++)
+				rotations[vertices[k]].push_back(edges_by_index[edges[pg.index(r[(shift[k]+j)%r.size()])]]);
+		}
+	}
+
+	for(size_t v=0; v<n; v++)
+		for(auto&& e : g.rotations[v])
+			if(!on_way[block[g.index(e)]])
+				rotations[v].push_back(e);
+	return std::make_pair(std::move(rotations),crossings);
+}
+
+/**
+ * A fast upper bound on the crossing number of graphs that are planar plus one edge. The edges of the Kuratowski subgraph of `g` are tried as the edge e with g - e planar,
+ * and each is inserted with insertEdge into the embedding of insertionEmbedding, so with the fewest crossings over all the embeddings of g - e.
+ * A later candidate only replaces the best insertion so far if it crosses fewer edges, and the search stops at a single crossing.
+ * With k edges in the Kuratowski subgraph, this takes O(k m log m) time.
+ *
+ * The number of crossings is exact when it is at most one. The inserted edge keeps its index on the piece at its first endpoint, and the planarization can be passed to drawFlattenedGraph.
+ *
+ * @return : The insertion with the fewest crossings, or nothing if no edge leaves a planar graph.
+ */
+template <typename Graph>
+auto singleEdgeInsertion(IndexedGraph<Graph> g) -> std::optional<EdgeInsertion<Graph>>{
+	auto result = planeEmbedding(std::move(g));
+	if(std::holds_alternative<PlanarGraph<Graph>>(result))
+		return EdgeInsertion<Graph>{std::move(std::get<0>(result)),0,true};
+
+	auto& neg = std::get<1>(result);
+	auto m = neg.numEdges();
+	std::vector<std::array<size_t,3>> candidates;
+	for(auto&& e : neg.forbidden_subgraph){
+		auto [u,v] = neg.endpoints(e);
+		candidates.push_back({neg.index(u),neg.index(v),neg.index(e)});
+	}
+
+	auto find_index = [](auto& h, size_t i){
+		for(auto&& e : h.edges())
+			if(h.index(e) == i)
+				return e;
+		return edge_t<Graph>{};
+	};
+
+	std::optional<EdgeInsertion<Graph>> best;
+	for(auto&& [s,t,i] : candidates){
+		//the last edge takes the index of the removed one
+		IndexedGraph<Graph> h(neg);
+		auto e = find_index(h,i);
+		h.changeIndex(find_index(h,m-1),i);
+		h.removeEdge(e);
+
+		auto embedded = planeEmbedding(std::move(h));
+		if(!std::holds_alternative<PlanarGraph<Graph>>(embedded))
+			continue;
+		auto& pg = std::get<0>(embedded);
+		auto embedding = insertionEmbedding(pg,s,t);
+		if(!embedding || (best && embedding->second >= best->crossings))
+			continue;
+		pg.rotations = std::move(embedding->first);
+
+		auto [planarization,crossings] = insertEdge(std::move(pg),s,t);
+
+		//the edges swap back their indices
+		if(i != m-1){
+			auto moved = find_index(planarization,i);
+			auto inserted = find_index(planarization,m-1);
+			planarization.changeIndex(moved,m-1);
+			planarization.changeIndex(inserted,i);
+		}
+		best = EdgeInsertion<Graph>{std::move(planarization),crossings,crossings <= 1};
+		if(best->exact)
+			break;
+	}
+
+	return best;
+}
+
+/**
+ * Recursion for projectiveXNumber. At the last crossing only pairs containing an edge of the obstruction found by projectivePlaneEmbedding are tried.
+ * The pairs of the topmost level are split in `slices`, and only those in `slice` are tried.
+ * That level gets `obstruction`, the edges of an obstruction of `g` marked by index, so `g` is not tested again.
+ * Unless `fewer` is set, no level tries fewer than `k` crossings, as when the caller tries the crossings one more at a time and has already ruled them out.
+ */
+template <typename Graph>
+auto projectiveXNumberRecursion(IndexedGraph<Graph>& g, size_t k, std::vector<edge_t<Graph>>& edges_by_index, auto& pp_test, auto& fake_cross, auto& uncross, const std::atomic<bool>& stop, size_t slice = 0, size_t slices = 1, const std::vector<bool>* obstruction = nullptr, bool fewer = true) -> std::optional<ProjectivePlanarGraph<Graph>>{
+	if(stop)
+		return {};
+
+	if(k==0){
+		auto variant_result = pp_test(g);
+		if(std::holds_alternative<ProjectivePlanarGraph<Graph>>(variant_result))
+			return std::move(std::get<0>(variant_result));
+		g = std::move(std::get<1>(variant_result));
+		return {};
+	}
+
+	auto ecount = num_edges(g.getGraph());
+	std::vector<bool> candidate(ecount,true);
+
+	if(k==1 && obstruction){
+		//Any drawing with one crossing has to cross an edge of the obstruction
+		for(size_t i=0; i<ecount; i++)
+			candidate[i] = (*obstruction)[i];
+	}
+	else if(k==1){
+		auto variant_result = pp_test(g);
+		if(std::holds_alternative<ProjectivePlanarGraph<Graph>>(variant_result))
+			return std::move(std::get<0>(variant_result));
+		auto& neg = std::get<1>(variant_result);
+		auto forbidden = std::move(neg.forbidden_subgraph);
+		g = std::move(neg);
+		if(stop)
+			return {};
+
+		std::fill(candidate.begin(),candidate.end(),false);
+		for(auto&& e : forbidden)
+			candidate[g.index(e)] = true;
+	}
+	else if(fewer){
+		auto result = projectiveXNumberRecursion(g,k-1,edges_by_index,pp_test,fake_cross,uncross,stop);
+		if(result)
+			return result;
+	}
+
+	size_t pair = 0;
+	for(size_t i =0 ; i< ecount ; i++){
+		auto e = edges_by_index[i];
+		for(size_t j =i; j< ecount ; j++){
+			auto f = edges_by_index[j];
+			if((candidate[i] || candidate[j]) && disjointEdges(g,e,f)){
+				if(pair++ % slices != slice)
+					continue;
+				fake_cross(e,f,i,j);
+				auto result = projectiveXNumberRecursion(g,k-1,edges_by_index,pp_test,fake_cross,uncross,stop,0,1,nullptr,fewer);
+				if(result || stop)
+					return result;
+				uncross(e,f,i,j);
+			}
+		}
+	}
+	return {};
+}
+
+/**
+ * Decides if `g` can be drawn in the projective plane with at most `k` crossings. Each crossing is replaced by a new vertex, and the planarized graph is tested with projectivePlaneEmbedding.
+ * The crossings are tried one more at a time, and each round is split among `threads` threads. The obstruction of `g` is found once, before the first round.
+ *
+ * @return : An optional containing the embedded planarized graph if it exists. The new vertices come after the ones in `g`.
+ */
+template <typename Graph>
+auto projectiveXNumber(IndexedGraph<Graph> g, size_t k, size_t threads = 1, seed_t seed = randomSeed()) -> std::optional<ProjectivePlanarGraph<Graph>>{
+	auto n = g.numVertices();
+
+	std::atomic<bool> found = false;
+	std::mutex result_mutex;
+	std::optional<ProjectivePlanarGraph<Graph>> result;
+
+	auto variant_result = projectivePlaneEmbedding(std::move(g),seed,found);
+	if(std::holds_alternative<ProjectivePlanarGraph<Graph>>(variant_result))
+		return std::move(std::get<0>(variant_result));
+	auto& neg = std::get<1>(variant_result);
+	std::vector<bool> obstruction(neg.numEdges(),false);
+	for(auto&& e : neg.forbidden_subgraph)
+		obstruction[neg.index(e)] = true;
+	g = std::move(neg);
+
+	auto search = [&](IndexedGraph<Graph> g, size_t crossings, size_t slice){
+		auto ecount = num_edges(g.getGraph());
+		auto vcount = num_vertices(g.getGraph());
+		std::vector<edge_t<Graph>> edges_by_index(ecount+2*k);
+		auto edgei_map = get( boost::edge_index, g.getGraph());
+
+		for([[maybe_unused]]auto&& _ : std::views::iota((size_t)0,k)){
+			add_vertex(g.getGraph());
+		}
+
+		for(auto&& e : range(edges(g.getGraph()))){
+			auto ei = get(edgei_map,e);
+			edges_by_index[ei] = e;
+		}
+
+		auto add_edge_with_index = [&g,&edgei_map,&edges_by_index](auto&& u, auto&& v, auto&& ei){
+				auto h = add_edge(u,v,g.getGraph()).first;
+				boost::put(edgei_map,h,ei);
+				edges_by_index[ei] = h;
+				return h;
+		};
+
+		auto fake_cross = [&g,&vcount,&add_edge_with_index,&ecount](auto&& e,auto&& f,auto&& ei, auto&& fi){
+			auto [u,v] = endpoints(g.getGraph(),e);
+			auto [a,b] = endpoints(g.getGraph(),f);
+
+			auto w = vertex(vcount,g.getGraph());
+
+			remove_edge(e,g.getGraph());
+			remove_edge(f,g.getGraph());
+
+			add_edge_with_index(w,u,ei);
+			add_edge_with_index(w,a,fi);
+			add_edge_with_index(w,v,ecount++);
+			add_edge_with_index(w,b,ecount++);
+
+			vcount++;
+		};
+
+		auto uncross = [&g,&vcount,&ecount,&add_edge_with_index](auto&& e, auto&& f,auto&& ei,auto&& fi){
+			vcount--;
+			clear_vertex(vertex(vcount,g.getGraph()),g.getGraph());
+			ecount-=2;
+
+			auto [u,v] = endpoints(g.getGraph(),e);
+			auto [a,b] = endpoints(g.getGraph(),f);
+
+			//revalidate descriptors...
+			e = add_edge_with_index(u,v,ei);
+			f = add_edge_with_index(a,b,fi);
+		};
+
+		auto pp_test = [&seed,&found](auto&& g){
+			return projectivePlaneEmbedding(std::move(g),seed,found);
+		};
+
+		auto pp = projectiveXNumberRecursion(g,crossings,edges_by_index,pp_test,fake_cross,uncross,found,slice,threads,&obstruction,false);
+		if(pp){
+			std::lock_guard<std::mutex> lock(result_mutex);
+			if(!result){
+				result = std::move(pp);
+				found = true;
+			}
+		}
+	};
+
+	threads = std::max(threads,(size_t)1);
+	for(size_t crossings=1; crossings<=k && !found; crossings++){
+		std::vector<std::thread> workers;
+		for(size_t i=1; i<threads; i++)
+			workers.emplace_back(search,g,crossings,i);
+		search(g,crossings,0);
+		for(auto&& t : workers)
+			t.join();
+	}
+
+	if(result){
+		//Only the unused crossing vertices are removed, the rotations are indexed by vertex
+		auto& pp = result.value();
+		auto v = pp.numVertices();
+		while(v > n && degree(pp.vertex(v-1),pp.getGraph()) == 0)
+			remove_vertex(pp.vertex(--v),pp.getGraph());
+		pp.rotations.resize(v);
+	}
+	return result;
+}
+
 template <typename Graph, typename Function>
 auto xNumberRecursion(IndexedGraph<Graph>& g,size_t k, Function& embedd_test, std::vector<edge_t<Graph>>& edges_by_index, auto& fake_cross, auto& uncross){
 	//std::cout << "k = "  << k<< std::endl;
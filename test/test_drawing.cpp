@@ -1,4 +1,6 @@
 #include <iostream>
+#include <random>
+#include <set>
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/is_straight_line_drawing.hpp>
@@ -7,6 +9,8 @@
 
 #include <gdraw/generators.hpp>
 #include <gdraw/draw.hpp>
+#include <gdraw/force_directed.hpp>
+#include <gdraw/crossings.hpp>
 
 #include <gdraw/io.hpp>
 
@@ -51,6 +55,444 @@ auto test_tuttedrawing1(){
 	ASSERT(coordinates[4].x ==0 && coordinates[4].y ==0);
 }
 
+auto test_tuttedrawing3(){
+	//every vertex not in the outer cycle is the barycenter of its neighbors
+	const int p = 30;
+	auto g = IndexedGraph<AdjList>{genGrid<AdjList>(p,p)};
+
+	std::vector<vertex_t<AdjList>> cycle;
+	for(int j=0; j<p; j++) cycle.push_back(j);
+	for(int i=1; i<p; i++) cycle.push_back(i*p+p-1);
+	for(int j=p-2; j>=0; j--) cycle.push_back((p-1)*p+j);
+	for(int i=p-2; i>0; i--) cycle.push_back(i*p);
+
+	auto cycle_coordinates = drawCycle(cycle.size());
+	auto coordinates = tutteDrawImpl(g,cycle,cycle_coordinates);
+
+	std::vector<bool> in_cycle(g.numVertices(),false);
+	for(auto&& v : cycle)
+		in_cycle[v] = true;
+
+	double error = 0;
+	for(auto&& v : g.vertices()){
+		if(in_cycle[v])
+			continue;
+		coord_t sum{0,0};
+		for(auto&& u : g.neighbors(v)){
+			sum.x += coordinates[u].x;
+			sum.y += coordinates[u].y;
+		}
+		error = std::max(error,std::abs(sum.x/g.degree(v) - coordinates[v].x));
+		error = std::max(error,std::abs(sum.y/g.degree(v) - coordinates[v].y));
+	}
+	ASSERT(error < 1e-8);
+}
+
+auto test_tuttedrawboost(){
+	auto g = IndexedGraph<AdjList>{genGrid<AdjList>(12,9)};
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(g));
+
+	auto dg = tutteDrawBoost(pg);
+	auto dg2 = tuttePlanarDraw(pg);
+	ASSERT(isStraightLineDrawing(dg));
+
+	double error = 0;
+	for(auto&& v : dg.vertices()){
+		error = std::max(error,std::abs(dg.coordinates[v].x - dg2.coordinates[v].x));
+		error = std::max(error,std::abs(dg.coordinates[v].y - dg2.coordinates[v].y));
+	}
+	ASSERT(error < 1e-8);
+
+	//moving the polygon reuses the factorization
+	auto cycle = findLargestFacialCycle(pg);
+	auto cycle_coordinates = drawCycle(cycle.size());
+	std::vector<std::pair<vertex_t<AdjList>,coord_t>> polygon;
+	for(size_t i=0; i<cycle.size(); i++)
+		polygon.push_back({cycle[i],cycle_coordinates[i]});
+
+	TutteSolver<AdjList> solver(pg.getGraph(),polygon);
+	for(auto&& c : cycle_coordinates)
+		c = {2*c.x+1,2*c.y};
+	auto coordinates = solver.solve(cycle_coordinates);
+
+	error = 0;
+	for(auto&& v : dg.vertices()){
+		error = std::max(error,std::abs(coordinates[v].x - (2*dg.coordinates[v].x+1)));
+		error = std::max(error,std::abs(coordinates[v].y - 2*dg.coordinates[v].y));
+	}
+	ASSERT(error < 1e-8);
+}
+
+auto test_multilevelTutteDraw(){
+	auto g = IndexedGraph<AdjList>{genGrid<AdjList>(40,40)};
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(g));
+
+	auto dg = multilevelTutteDraw(pg);
+	auto dg2 = tuttePlanarDraw(pg);
+
+	double error = 0;
+	for(auto&& v : dg.vertices()){
+		error = std::max(error,std::abs(dg.coordinates[v].x - dg2.coordinates[v].x));
+		error = std::max(error,std::abs(dg.coordinates[v].y - dg2.coordinates[v].y));
+	}
+	ASSERT(error < 1e-8);
+
+	arma::sp_mat L = laplacian(g);
+	L(0,0) = L(0,0) + 1;
+	MultilevelPreconditioner precond(L,10);
+	ASSERT(precond.numLevels() > 2);
+
+	arma::vec b(g.numVertices(),arma::fill::zeros);
+	b(g.numVertices()-1) = 1;
+	arma::vec x = conjugateGradient(L,b,arma::vec(g.numVertices(),arma::fill::zeros),precond);
+	ASSERT(arma::norm(L*x - b) < 1e-8);
+
+	//the inner vertices of K_{2,n} with the other two fixed are not adjacent, so the coarsening stalls on a level too large to invert
+	const size_t n = 2000;
+	auto k2n = IndexedGraph<AdjList>{getKpq<AdjList>(2,n)};
+	const arma::sp_mat K = laplacian(k2n);
+	arma::sp_mat D(n,n);
+	for(size_t i=0; i<n; i++)
+		D(i,i) = K(2+i,2+i);
+	MultilevelPreconditioner stalled(D,10);
+	ASSERT(stalled.numLevels() == 1);
+
+	arma::vec c(n,arma::fill::ones);
+	arma::vec y = conjugateGradient(D,c,arma::vec(n,arma::fill::zeros),stalled);
+	ASSERT(arma::norm(D*y - c) < 1e-8);
+}
+
+auto test_incrementalTutteDraw(){
+	const int p = 20;
+	auto g = IndexedGraph<AdjList>{genGrid<AdjList>(p,p)};
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(g));
+	auto cycle = findLargestFacialCycle(pg);
+	auto dg = tuttePlanarDraw(pg);
+
+	//a diagonal in one face and an edge removed from another
+	std::vector<GraphEdit> edits{
+		{GraphEdit::AddEdge,5*p+5,6*p+6},
+		{GraphEdit::RemoveEdge,12*p+12,12*p+13}
+	};
+	auto redrawn = incrementalTutteDraw(dg,edits,cycle,1e-12);
+	ASSERT(redrawn.numEdges() == dg.numEdges());
+	ASSERT(redrawn.edge(redrawn.vertex(5*p+5),redrawn.vertex(6*p+6)));
+	ASSERT(!redrawn.edge(redrawn.vertex(12*p+12),redrawn.vertex(12*p+13)));
+
+	auto h = IndexedGraph<AdjList>{genGrid<AdjList>(p,p)};
+	h.addEdge(5*p+5,6*p+6);
+	remove_edge(12*p+12,12*p+13,h.getGraph());
+	auto cycle_coordinates = drawCycle(cycle.size());
+	auto coordinates = tutteDrawImpl(h,cycle,cycle_coordinates);
+
+	double error = 0;
+	for(auto&& v : h.vertices()){
+		error = std::max(error,std::abs(redrawn.coordinates[v].x - coordinates[v].x));
+		error = std::max(error,std::abs(redrawn.coordinates[v].y - coordinates[v].y));
+	}
+	ASSERT(error < 1e-8);
+}
+
+auto test_forceDirectedDraw(){
+	auto g = IndexedGraph<AdjList>{genGrid<AdjList>(10,10)};
+	auto n = g.numVertices();
+	auto dg = DrawnGraph<AdjList>(std::move(g),drawCycle(n));
+
+	auto fd = forceDirectedDraw(dg,200,1);
+	auto fd2 = forceDirectedDraw(dg,200,3);
+
+	double edge_length = 0;
+	for(auto&& e : fd.edges()){
+		auto [u,v] = fd.endpoints(e);
+		edge_length += std::hypot(fd.coordinates[u].x - fd.coordinates[v].x, fd.coordinates[u].y - fd.coordinates[v].y);
+	}
+	edge_length /= fd.numEdges();
+
+	double distance = 0;
+	for(size_t i=0; i<n; i++)
+		for(size_t j=i+1; j<n; j++)
+			distance += std::hypot(fd.coordinates[i].x - fd.coordinates[j].x, fd.coordinates[i].y - fd.coordinates[j].y);
+	distance /= n*(n-1)/2;
+
+	ASSERT(std::isfinite(edge_length));
+	ASSERT(3*edge_length < distance);
+
+	bool same = true;
+	for(size_t i=0; i<n; i++)
+		same = same && fd.coordinates[i].x == fd2.coordinates[i].x && fd.coordinates[i].y == fd2.coordinates[i].y;
+	ASSERT(same);
+}
+
+auto test_crossingPairs(){
+	//a square with both diagonals
+	auto g = IndexedGraph<AdjList>{getKn<AdjList>(4)};
+	auto dg = DrawnGraph<AdjList>(std::move(g),{{0,0},{1,0},{1,1},{0,1}});
+	ASSERT(crossingPairs(dg).size() == 1);
+	ASSERT(!isStraightLineDrawing(dg));
+
+	//against all pairs on a random drawing
+	auto h = IndexedGraph<AdjList>{getKn<AdjList>(12)};
+	std::vector<coord_t> coordinates;
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<double> dist(-1,1);
+	for(size_t i=0; i<h.numVertices(); i++)
+		coordinates.push_back({dist(gen),dist(gen)});
+	auto dh = DrawnGraph<AdjList>(std::move(h),coordinates);
+
+	size_t count = 0;
+	for(auto&& e : dh.edges())
+		for(auto&& f : dh.edges()){
+			auto [a,b] = dh.endpoints(e);
+			auto [c,d] = dh.endpoints(f);
+			if(dh.index(e) < dh.index(f) && a!=c && a!=d && b!=c && b!=d && intersect(coordinates[a],coordinates[b],coordinates[c],coordinates[d]))
+				count++;
+		}
+	ASSERT(crossingPairs(dh).size() == count);
+
+	//long segments that are all active at once, a few of them crossing
+	auto l = IndexedGraph<AdjList>{AdjList(60)};
+	std::vector<coord_t> long_coordinates;
+	for(size_t i=0; i<30; i++){
+		l.addEdge(2*i,2*i+1);
+		long_coordinates.push_back({-1 - dist(gen)/10,(double)i});
+		long_coordinates.push_back({1 + dist(gen)/10,(i%5 == 0 ? i+1.5 : i)});
+	}
+	auto dl = DrawnGraph<AdjList>(std::move(l),long_coordinates);
+	size_t long_count = 0;
+	for(size_t i=0; i<30; i++)
+		for(size_t j=i+1; j<30; j++)
+			if(intersect(long_coordinates[2*i],long_coordinates[2*i+1],long_coordinates[2*j],long_coordinates[2*j+1]))
+				long_count++;
+	ASSERT(long_count == 6);
+	ASSERT(crossingPairs(dl).size() == long_count);
+}
+
+auto test_countCrossings(){
+	auto g = IndexedGraph<AdjList>{AdjList(6)};
+	auto arch = g.addEdge(0,1);
+	g.addEdge(2,3);
+	g.addEdge(4,5);
+	std::vector<coord_t> coordinates {{0,0},{2,0},{1,-1},{1,3},{-1,1},{3,1}};
+	std::map<edge_t<AdjList>,cubicSpline> splines {{arch,cubicSpline({0,0},{0,2},{2,2},{2,0})}};
+	auto dg = DrawnGraph<AdjList>(std::move(g),coordinates,splines);
+
+	//the arch crosses the horizontal segment twice
+	auto [count,pairs] = countCrossings(dg);
+	ASSERT(count == 4);
+	ASSERT(pairs.size() == 3);
+
+	auto h = IndexedGraph<AdjList>{getKn<AdjList>(12)};
+	std::vector<coord_t> random_coordinates;
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<double> dist(-1,1);
+	for(size_t i=0; i<h.numVertices(); i++)
+		random_coordinates.push_back({dist(gen),dist(gen)});
+	auto dh = DrawnGraph<AdjList>(std::move(h),random_coordinates);
+
+	auto [h_count,h_pairs] = countCrossings(dh);
+	ASSERT(h_count == crossingPairs(dh).size());
+	ASSERT(h_pairs.size() == h_count);
+}
+
+auto test_spatialIndex(){
+	auto g = IndexedGraph<AdjList>{getKn<AdjList>(40)};
+	std::vector<coord_t> coordinates;
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<double> dist(-1,1);
+	for(size_t i=0; i<g.numVertices(); i++)
+		coordinates.push_back({dist(gen),dist(gen)});
+	auto dg = DrawnGraph<AdjList>(std::move(g),coordinates);
+
+	SpatialIndex index(dg,3);
+	ASSERT(index.numSegments() == dg.numEdges());
+
+	auto brute_range = [&](coord_t p, coord_t q){
+		std::vector<size_t> result;
+		for(size_t v=0; v<coordinates.size(); v++)
+			if(p.x <= coordinates[v].x && coordinates[v].x <= q.x && p.y <= coordinates[v].y && coordinates[v].y <= q.y)
+				result.push_back(v);
+		return result;
+	};
+	auto brute_nearest = [&](coord_t p){
+		size_t best = 0;
+		for(size_t v=1; v<coordinates.size(); v++)
+			if(std::hypot(coordinates[v].x-p.x,coordinates[v].y-p.y) < std::hypot(coordinates[best].x-p.x,coordinates[best].y-p.y))
+				best = v;
+		return best;
+	};
+
+	for(size_t k=0; k<20; k++){
+		coord_t p{dist(gen),dist(gen)};
+		coord_t q{p.x + 0.5,p.y + 0.5};
+		ASSERT(index.verticesIn(p,q) == brute_range(p,q));
+		ASSERT(index.nearestVertex(p) == brute_nearest(p));
+	}
+	//outside the grid
+	ASSERT(index.nearestVertex({5,5}) == brute_nearest({5,5}));
+
+	ASSERT(crossingPairs(dg,index).size() == crossingPairs(dg).size());
+	ASSERT(crossingPairs(dg,SpatialIndex(dg,1)) == crossingPairs(dg,index));
+
+	//moving vertices keeps the queries exact
+	for(size_t v=0; v<10; v++){
+		coordinates[v] = {dist(gen)*2,dist(gen)*2};
+		index.moveVertex(v,coordinates[v]);
+		dg.coordinates[v] = coordinates[v];
+	}
+	coord_t p{-0.5,-0.5};
+	ASSERT(index.verticesIn(p,{0.5,0.5}) == brute_range(p,{0.5,0.5}));
+	ASSERT(index.nearestVertex(p) == brute_nearest(p));
+	ASSERT(crossingPairs(dg,index).size() == crossingPairs(dg).size());
+
+	//a square with both diagonals
+	auto h = IndexedGraph<AdjList>{getKn<AdjList>(4)};
+	auto dh = DrawnGraph<AdjList>(std::move(h),{{0,0},{1,0},{1,1},{0,1}});
+	SpatialIndex square(dh);
+	ASSERT(!isStraightLineDrawing(dh,square));
+	square.moveVertex(2,{0.2,0.2});
+	ASSERT(isStraightLineDrawing(dh,square));
+}
+
+auto test_drawnGraphAttributes(){
+	auto g = IndexedGraph<AdjList>{getKn<AdjList>(4)};
+	auto e = *g.edges().begin();
+	auto dg = DrawnGraph<AdjList>(std::move(g),{{0,0},{1,0},{1,1},{0,1}});
+	dg.edge_coordinates.set(dg.index(e),cubicSpline({0,0},{0,1},{1,1},{1,0}));
+	dg.colorEdge(e,"red");
+	dg.colorVertex(dg.vertex(2),"blue");
+	dg.colorVertex(dg.vertex(3),"red");
+
+	//colors are interned
+	ASSERT(dg.palette.size() == 3);
+	ASSERT(dg.vertex_colors[3] == dg.edge_colors[dg.index(e)]);
+
+	auto copy = dg;
+	auto f = copy.edge(copy.vertex(0),copy.vertex(1));
+	ASSERT(f && copy.index(f.value()) == dg.index(e));
+	ASSERT(copy.edge_coordinates.contains(copy.index(f.value())));
+	ASSERT(copy.edge_coordinates.size() == 1);
+	ASSERT(copy.edgeColor(f.value()) == "red");
+	ASSERT(copy.vertexColor(copy.vertex(2)) == "blue");
+	ASSERT(copy.vertexColor(copy.vertex(0)) == "");
+
+	std::ostringstream out;
+	writeDOT(copy,out);
+	ASSERT(out.str().find("color=red") != std::string::npos);
+	ASSERT(out.str().find("color=blue") != std::string::npos);
+
+	//the last edge takes the index of a removed edge, with its attributes
+	auto last = dg.numEdges()-1;
+	dg.moveEdgeAttributes(dg.index(e),last);
+	ASSERT(dg.edge_coordinates.contains(last));
+	ASSERT(!dg.edge_coordinates.contains(dg.index(e)));
+	ASSERT(dg.edge_colors[last] == dg.vertex_colors[3]);
+	ASSERT(dg.edgeColor(e) == "");
+
+	//removing the edge with the last index drops its attributes, so an edge added later does not take them
+	auto k4 = DrawnGraph<AdjList>(IndexedGraph<AdjList>{getKn<AdjList>(4)},{{0,0},{4,0},{2,4},{2,1}});
+	auto f23 = k4.edge(k4.vertex(2),k4.vertex(3)).value();
+	ASSERT(k4.index(f23) == k4.numEdges()-1);
+	k4.edge_coordinates.set(k4.index(f23),cubicSpline({2,4},{2,3},{2,2},{2,1}));
+	k4.colorEdge(f23,"green");
+	std::vector<GraphEdit> edits{
+		{GraphEdit::RemoveEdge,2,3},
+		{GraphEdit::AddEdge,2,3}
+	};
+	auto redrawn = incrementalTutteDraw(k4,edits,{k4.vertex(0),k4.vertex(1),k4.vertex(2)});
+	auto g23 = redrawn.edge(redrawn.vertex(2),redrawn.vertex(3)).value();
+	ASSERT(redrawn.edgeColor(g23) == "");
+	ASSERT(!redrawn.edge_coordinates.contains(redrawn.index(g23)));
+
+	//the palette is limited by the ids
+	for(size_t i=dg.palette.size(); i<=std::numeric_limits<DrawnGraph<AdjList>::color_t>::max(); i++)
+		ASSERT(dg.colorId(std::to_string(i)));
+	ASSERT(!dg.colorEdge(e,"one too many"));
+	ASSERT(dg.colorEdge(e,"red"));
+}
+
+auto test_drawFlattenedGraph(){
+	//the edge 0-1 crosses 2-3 at 6 and 4-5 at 7
+	auto g = IndexedGraph<AdjList>{AdjList(8)};
+	auto e06 = g.addEdge(0,6,0);
+	auto e26 = g.addEdge(2,6,1);
+	auto e47 = g.addEdge(4,7,2);
+	auto e67 = g.addEdge(6,7,3);
+	auto e71 = g.addEdge(7,1,4);
+	auto e63 = g.addEdge(6,3,5);
+	auto e75 = g.addEdge(7,5,6);
+	rotations_t<AdjList> rotations {{e06},{e71},{e26},{e63},{e47},{e75},{e06,e26,e67,e63},{e67,e47,e71,e75}};
+	auto pg = PlanarGraph<AdjList>(std::move(g),rotations);
+
+	std::vector<coord_t> coordinates {{0,0},{3,0},{1,-1},{1,1},{2,-1},{2,1},{1,0},{2,0}};
+	std::function<DrawnGraph<AdjList>(PlanarGraph<AdjList>)> place = [&coordinates](auto&& h){
+		return DrawnGraph<AdjList>(std::move(h),coordinates);
+	};
+	auto dg = drawFlattenedGraph(std::move(pg),6,place);
+
+	ASSERT(dg.numVertices() == 6);
+	ASSERT(dg.numEdges() == 3);
+	ASSERT(dg.edge_coordinates.size() == 3);
+	auto e = dg.edge(dg.vertex(0),dg.vertex(1));
+	ASSERT(e && dg.index(e.value()) == 0);
+	auto f = dg.edge(dg.vertex(4),dg.vertex(5));
+	ASSERT(f && dg.index(f.value()) == 2);
+
+	auto [count,pairs] = countCrossings(dg);
+	ASSERT(count == 2);
+	ASSERT(pairs.size() == 2);
+}
+
+auto test_schnyderDraw(){
+	std::vector<IndexedGraph<AdjList>> graphs {
+		IndexedGraph<AdjList>{getKn<AdjList>(4)},
+		IndexedGraph<AdjList>{genCycle<AdjList>(5)},
+		IndexedGraph<AdjList>{genGrid<AdjList>(7,5)},
+	};
+	//a grid with diagonals in alternate directions
+	auto g = IndexedGraph<AdjList>{genGrid<AdjList>(6,6)};
+	for(size_t i=0; i+1<6; i++)
+		for(size_t j=0; j+1<6; j++)
+			if((i+j)%2)
+				g.addEdge(i*6+j,(i+1)*6+j+1);
+			else
+				g.addEdge(i*6+j+1,(i+1)*6+j);
+	graphs.push_back(std::move(g));
+
+	for(auto&& g : graphs){
+		auto n = g.numVertices();
+		auto pg = makeMaximal(std::get<PlanarGraph<AdjList>>(planeEmbedding(g)));
+		auto dg = schnyderDraw(std::move(pg));
+
+		ASSERT(isStraightLineDrawing(dg));
+		std::set<std::pair<double,double>> points;
+		for(auto&& p : dg.coordinates){
+			ASSERT(p.x == std::floor(p.x) && p.y == std::floor(p.y));
+			ASSERT(0 <= p.x && p.x <= n-2 && 0 <= p.y && p.y <= n-2);
+			points.insert({p.x,p.y});
+		}
+		ASSERT(points.size() == n);
+	}
+
+	//without the extra edges
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(IndexedGraph<AdjList>{genGrid<AdjList>(5,5)}));
+	auto dg = schnyderDraw(std::move(pg));
+	ASSERT(dg.numEdges() == 40);
+	ASSERT(isStraightLineDrawing(dg));
+}
+
+auto test_conjugateGradient(){
+	auto g = IndexedGraph<AdjList>{genPath<AdjList>(10)};
+	arma::sp_mat L = laplacian(g);
+	//grounds vertex 0
+	L(0,0) = L(0,0) + 1;
+
+	arma::vec b(11,arma::fill::zeros);
+	b(10) = 1;
+	arma::vec x = conjugateGradient(L,b);
+
+	ASSERT(arma::norm(L*x - b) < 1e-8);
+}
+
 auto test_intersect(){
 
 	coord_t a = {1,1};
@@ -150,4 +592,16 @@ int main(){
 	test_intersect();
 	test_tuttedrawing1();
 	test_tuttedrawing2();
+	test_tuttedrawing3();
+	test_conjugateGradient();
+	test_tuttedrawboost();
+	test_multilevelTutteDraw();
+	test_incrementalTutteDraw();
+	test_forceDirectedDraw();
+	test_crossingPairs();
+	test_countCrossings();
+	test_spatialIndex();
+	test_drawnGraphAttributes();
+	test_drawFlattenedGraph();
+	test_schnyderDraw();
 }
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 
 #include <boost/graph/adjacency_list.hpp>
@@ -21,8 +22,96 @@ using AdjList = boost::adjacency_list<
 
 using namespace gdraw;
 
+/** An embedding of K33 in the projective plane, with four faces and the edges 1-3 and 2-5 negative. */
+auto projectiveK33(){
+	IndexedGraph<AdjList> g {gdraw::getKpq<AdjList>(3,3)};
+	rotations_t<AdjList> rotations = {
+		{edge(0,3,g.getGraph()).first,edge(0,5,g.getGraph()).first,edge(0,4,g.getGraph()).first},
+		{edge(1,3,g.getGraph()).first,edge(1,4,g.getGraph()).first,edge(1,5,g.getGraph()).first},
+		{edge(2,3,g.getGraph()).first,edge(2,4,g.getGraph()).first,edge(2,5,g.getGraph()).first},
+		{edge(3,0,g.getGraph()).first,edge(3,2,g.getGraph()).first,edge(3,1,g.getGraph()).first},
+		{edge(4,0,g.getGraph()).first,edge(4,1,g.getGraph()).first,edge(4,2,g.getGraph()).first},
+		{edge(5,0,g.getGraph()).first,edge(5,2,g.getGraph()).first,edge(5,1,g.getGraph()).first}
+	};
+	std::vector<int> esignals(g.numEdges(),1);
+	esignals[g.index(g.edge(1,3).value())] = -1;
+	esignals[g.index(g.edge(2,5).value())] = -1;
+	return EmbeddedGraph<AdjList>(std::move(g),std::move(rotations),std::move(esignals));
+}
+
+/** An h x w grid on the torus with the same rotation at every vertex, and the edges to the right of and below each vertex. */
+struct TorusGrid{
+	EmbeddedGraph<AdjList> graph;
+	std::vector<edge_t<AdjList>> right, down;
+};
+
+auto torusGrid(size_t h, size_t w){
+	auto g = IndexedGraph<AdjList>{AdjList(h*w)};
+	std::vector<edge_t<AdjList>> right(h*w), down(h*w);
+	size_t index = 0;
+	for(size_t i=0; i<h; i++)
+		for(size_t j=0; j<w; j++){
+			right[i*w+j] = g.addEdge(g.vertex(i*w+j),g.vertex(i*w+(j+1)%w),index++);
+			down[i*w+j] = g.addEdge(g.vertex(i*w+j),g.vertex(((i+1)%h)*w+j),index++);
+		}
+	rotations_t<AdjList> rotations(h*w);
+	for(size_t i=0; i<h; i++)
+		for(size_t j=0; j<w; j++)
+			rotations[i*w+j] = {right[i*w+j],down[i*w+j],right[i*w+(j+w-1)%w],down[((i+h-1)%h)*w+j]};
+	return TorusGrid{EmbeddedGraph<AdjList>(std::move(g),std::move(rotations),std::vector<int>(2*h*w,1)),std::move(right),std::move(down)};
+}
+
+/** The grid of torusGrid with its left and right sides glued upside down through negative edges, a Klein bottle. */
+auto kleinGrid(size_t h, size_t w){
+	auto g = IndexedGraph<AdjList>{AdjList(h*w)};
+	std::vector<edge_t<AdjList>> right(h*w), down(h*w);
+	std::vector<int> esignals(2*h*w,1);
+	size_t index = 0;
+	for(size_t i=0; i<h; i++)
+		for(size_t j=0; j<w; j++){
+			if(j+1 == w)
+				esignals[index] = -1;
+			right[i*w+j] = g.addEdge(g.vertex(i*w+j),g.vertex(j+1 < w ? i*w+j+1 : (h-1-i)*w),index++);
+			down[i*w+j] = g.addEdge(g.vertex(i*w+j),g.vertex(((i+1)%h)*w+j),index++);
+		}
+	rotations_t<AdjList> rotations(h*w);
+	for(size_t i=0; i<h; i++)
+		for(size_t j=0; j<w; j++){
+			auto left = j > 0 ? right[i*w+j-1] : right[(h-1-i)*w+w-1];
+			rotations[i*w+j] = {right[i*w+j],down[i*w+j],left,down[((i+h-1)%h)*w+j]};
+		}
+	return EmbeddedGraph<AdjList>(std::move(g),std::move(rotations),std::move(esignals));
+}
 
 auto test_smalles1sidescycle(){
+	auto eg = projectiveK33();
+
+	auto cycle = smallest1SidedCycle(eg);
+
+	//for(auto&& e : cycle)
+	//	std::cout << e << ' ';
+	//std::cout << std::endl;
+
+	ASSERT(cycle.size()==4);
+
+}
+
+auto test_smallest1SidedCycleBatches(){
+	//a Möbius band: a long cycle with a chord, where the half with the negative edge is the smallest 1-sided cycle
+	auto g = IndexedGraph{genCycle<AdjList>(100)};
+	g.addEdge(g.vertex(0),g.vertex(50));
+
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(std::move(g)));
+	pg.edge_signals[pg.index(pg.edge(99,0).value())] = -1;
+
+	for(size_t threads : {1,3}){
+		auto cycle = smallest1SidedCycle(pg,threads);
+		ASSERT(cycle.size()==51);
+		ASSERT(is1Sided(pg,cycle));
+	}
+}
+
+auto test_signalParityIndex(){
 	IndexedGraph<AdjList> g {gdraw::getKpq<AdjList>(3,3)};
 	
 	rotations_t<AdjList> rotations = {
@@ -42,14 +131,22 @@ auto test_smalles1sidescycle(){
 
 	auto eg = EmbeddedGraph<AdjList>(std::move(g),std::move(rotations),std::move(esignals));
 
-	auto cycle = smallest1SidedCycle(eg);
-
-	//for(auto&& e : cycle)
-	//	std::cout << e << ' ';
-	//std::cout << std::endl;
-
-	ASSERT(cycle.size()==4);
-
+	auto tree = dfsForest(eg,0);
+	SignalParityIndex<AdjList> parity(eg,tree);
+
+	size_t one_sided = 0;
+	for(auto&& e : eg.edges()){
+		auto [a,b] = eg.endpoints(e);
+		if(e == tree[a] || e == tree[b]){
+			ASSERT(!parity.is1Sided(e));
+			continue;
+		}
+		auto cycle = fundamentalCycle(eg,tree,e);
+		ASSERT(parity.is1Sided(e) == is1Sided(eg,cycle));
+		one_sided += parity.is1Sided(e);
+	}
+
+	ASSERT(one_sided > 0);
 }
 
 auto test_allFacialWalks(){
@@ -106,24 +203,7 @@ auto test_allFacialWalks2(){
 }
 
 auto test_allFacialWalks3(){
-	IndexedGraph<AdjList> g {gdraw::getKpq<AdjList>(3,3)};
-	
-	rotations_t<AdjList> rotations = {
-		{edge(0,3,g.getGraph()).first,edge(0,5,g.getGraph()).first,edge(0,4,g.getGraph()).first},
-		{edge(1,3,g.getGraph()).first,edge(1,4,g.getGraph()).first,edge(1,5,g.getGraph()).first},
-		{edge(2,3,g.getGraph()).first,edge(2,4,g.getGraph()).first,edge(2,5,g.getGraph()).first},
-		{edge(3,0,g.getGraph()).first,edge(3,2,g.getGraph()).first,edge(3,1,g.getGraph()).first},
-		{edge(4,0,g.getGraph()).first,edge(4,1,g.getGraph()).first,edge(4,2,g.getGraph()).first},
-		{edge(5,0,g.getGraph()).first,edge(5,2,g.getGraph()).first,edge(5,1,g.getGraph()).first}
-	};
-
-	auto edgei_map = get(boost::edge_index, g.getGraph());
-	std::vector<int> esignals(num_edges(g.getGraph()),1);
-
-	esignals[boost::get(edgei_map,edge(1,3,g.getGraph()).first)] = -1;
-	esignals[boost::get(edgei_map,edge(2,5,g.getGraph()).first)] = -1;
-
-	auto eg = EmbeddedGraph<AdjList>(std::move(g),std::move(rotations),std::move(esignals));
+	auto eg = projectiveK33();
 
 	auto all_walks = allFacialWalks(eg);
 
@@ -162,12 +242,200 @@ auto test_allFacialWalks4(){
 }
 
 
+auto test_dualGraph(){
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(IndexedGraph<AdjList>{getKn<AdjList>(4)}));
+
+	auto dual = dualGraph(pg);
+
+	ASSERT(dual.numFaces()==4);
+	ASSERT(dual.numEdges()==6);
+	for(size_t f=0; f<dual.numFaces(); f++){
+		ASSERT(dual.face(f).size()==3);
+		for(auto&& side : dual.face(f)){
+			ASSERT(dual.endpoints(side/2)[side%2]==f);
+			ASSERT(dual.across(side)!=f);
+		}
+	}
+
+	//the projective planar K33
+	auto eg = projectiveK33();
+
+	auto pdual = dualGraph(eg);
+
+	ASSERT(pdual.numFaces()==4);
+	std::vector<int> seen(2*pdual.numEdges(),0);
+	for(size_t f=0; f<pdual.numFaces(); f++)
+		for(auto&& side : pdual.face(f)){
+			seen[side]++;
+			ASSERT(pdual.endpoints(side/2)[side%2]==f);
+		}
+	ASSERT(std::all_of(seen.begin(),seen.end(),[](auto c){ return c==1; }));
+}
+
+auto test_splitFace(){
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(IndexedGraph<AdjList>{genCycle<AdjList>(6)}));
+
+	auto dual = dualGraph(pg);
+	ASSERT(dual.numFaces()==2);
+
+	auto old_face = std::vector<size_t>(dual.face(0).begin(),dual.face(0).end());
+	auto f = dual.splitFace(0,1,4);
+
+	ASSERT(f==2);
+	ASSERT(dual.numFaces()==3);
+	ASSERT(dual.numEdges()==7);
+	ASSERT(dual.face(0).size()==4);
+	ASSERT(dual.face(2).size()==4);
+	ASSERT(dual.face(1).size()==6);
+	ASSERT(dual.endpoints(6)[0]==0 && dual.endpoints(6)[1]==2);
+
+	ASSERT(dual.face(0)[0]==old_face[1] && dual.face(0)[2]==old_face[3] && dual.face(0)[3]==12);
+	ASSERT(dual.face(2)[0]==old_face[4] && dual.face(2)[2]==old_face[0] && dual.face(2)[3]==13);
+	for(size_t g=0; g<dual.numFaces(); g++)
+		for(auto&& side : dual.face(g))
+			ASSERT(dual.endpoints(side/2)[side%2]==g);
+
+	//the new edge splits again
+	dual.splitFace(2,0,2);
+	ASSERT(dual.numFaces()==4);
+	ASSERT(dual.face(2).size()==3);
+	ASSERT(dual.face(3).size()==3);
+	ASSERT(dual.across(2*7)==3);
+}
+
+auto test_edgeWidth(){
+	//a 4x5 grid on the torus
+	size_t h = 4, w = 5;
+	auto torus = torusGrid(h,w).graph;
+
+	ASSERT(eulerGenus(torus)==2);
+	auto cycle = shortestNonseparatingCycle(torus);
+	ASSERT(cycle.size()==4);
+	std::vector<size_t> degree(h*w,0);
+	for(auto&& e : cycle){
+		auto [u,v] = torus.endpoints(e);
+		degree[torus.index(u)]++;
+		degree[torus.index(v)]++;
+	}
+	ASSERT(std::all_of(degree.begin(),degree.end(),[](auto d){ return d==0 || d==2; }));
+
+	//on the projective plane the nonseparating cycles are the 1-sided ones
+	auto pp = projectiveK33();
+
+	ASSERT(eulerGenus(pp)==1);
+	ASSERT(edgeWidth(pp)==smallest1SidedCycle(pp).size());
+	ASSERT(is1Sided(pp,shortestNonseparatingCycle(pp)));
+
+	auto plane = std::get<PlanarGraph<AdjList>>(planeEmbedding(IndexedGraph<AdjList>{getKn<AdjList>(4)}));
+	ASSERT(edgeWidth(plane)==0);
+
+	//a Klein bottle
+	auto klein = kleinGrid(h,w);
+
+	//the columns do not separate, but some non-contractible cycles do
+	ASSERT(eulerGenus(klein)==2);
+	ASSERT(!separatingIsContractible(klein));
+	ASSERT(!edgeWidth(klein));
+	ASSERT(nonseparatingEdgeWidth(klein)==4);
+	ASSERT(separatingIsContractible(torus) && edgeWidth(torus)==4);
+}
+
+auto test_homologyIndex(){
+	//a 4x5 grid on the torus
+	size_t h = 4, w = 5;
+	auto [torus,right,down] = torusGrid(h,w);
+
+	HomologyIndex<AdjList> homology(torus);
+	ASSERT(homology.genus()==2);
+
+	std::vector<edge_t<AdjList>> row0, row2, column0, square;
+	for(size_t j=0; j<w; j++){
+		row0.push_back(right[j]);
+		row2.push_back(right[2*w+j]);
+	}
+	for(size_t i=0; i<h; i++)
+		column0.push_back(down[i*w]);
+	square = {right[0],down[1],right[w],down[0]};
+
+	ASSERT(!homology.isNullHomologous(row0));
+	ASSERT(!homology.isNullHomologous(column0));
+	ASSERT(homology.isNullHomologous(square));
+	ASSERT(homology.homologous(row0,row2));
+	ASSERT(!homology.homologous(row0,column0));
+	ASSERT(!homology.is1Sided(row0));
+	for(auto&& walk : allFacialWalks(torus))
+		ASSERT(homology.isNullHomologous(walk));
+
+	//on the projective plane the index agrees with is1Sided
+	auto pp = projectiveK33();
+
+	HomologyIndex<AdjList> pp_homology(pp);
+	ASSERT(pp_homology.genus()==1);
+	auto pp_tree = dfsForest(pp,0);
+	for(auto&& e : pp.edges()){
+		auto [a,b] = pp.endpoints(e);
+		if(e == pp_tree[a] || e == pp_tree[b])
+			continue;
+		auto cycle = fundamentalCycle(pp,pp_tree,e);
+		ASSERT(pp_homology.is1Sided(cycle)==is1Sided(pp,cycle));
+		//on the projective plane the 1-sided cycles are the nonseparating ones
+		ASSERT(pp_homology.is1Sided(cycle)!=pp_homology.isNullHomologous(cycle));
+	}
+}
+
+auto test_faceWidth(){
+	//a 3x4 torus grid with every edge subdivided, the midpoints after the grid vertices
+	size_t h = 3, w = 4;
+	auto g = IndexedGraph<AdjList>{AdjList(3*h*w)};
+	std::vector<edge_t<AdjList>> right(h*w), left(h*w), down(h*w), up(h*w);
+	rotations_t<AdjList> rotations(3*h*w);
+	size_t index = 0;
+	for(size_t i=0; i<h; i++)
+		for(size_t j=0; j<w; j++){
+			auto v = i*w+j, r = h*w + v, d = 2*h*w + v;
+			right[v] = g.addEdge(g.vertex(v),g.vertex(r),index++);
+			left[i*w+(j+1)%w] = g.addEdge(g.vertex(r),g.vertex(i*w+(j+1)%w),index++);
+			down[v] = g.addEdge(g.vertex(v),g.vertex(d),index++);
+			up[((i+1)%h)*w+j] = g.addEdge(g.vertex(d),g.vertex(((i+1)%h)*w+j),index++);
+			rotations[r] = {right[v],left[i*w+(j+1)%w]};
+			rotations[d] = {down[v],up[((i+1)%h)*w+j]};
+		}
+	for(size_t v=0; v<h*w; v++)
+		rotations[v] = {right[v],down[v],left[v],up[v]};
+	auto torus = EmbeddedGraph<AdjList>(std::move(g),std::move(rotations),std::vector<int>(index,1));
+
+	//subdividing doubles the edge-width but keeps the face-width
+	ASSERT(edgeWidth(torus)==6);
+	ASSERT(faceWidth(torus)==3);
+	ASSERT(faceWidth(torus,3)==3);
+
+	auto pp = projectiveK33();
+	ASSERT(faceWidth(pp)==2);
+	ASSERT(faceWidth(pp,2)==2);
+
+	auto plane = std::get<PlanarGraph<AdjList>>(planeEmbedding(IndexedGraph<AdjList>{getKn<AdjList>(4)}));
+	ASSERT(faceWidth(plane)==0);
+
+	//on the Klein bottle only the bound on nonseparating curves is given
+	auto klein = kleinGrid(4,5);
+	ASSERT(!faceWidth(klein));
+	ASSERT(nonseparatingFaceWidth(klein)==4);
+	ASSERT(nonseparatingFaceWidth(klein,2)==4);
+}
+
 int main(){
 	std::cout << "Testing : " << __FILE__ << std::endl;
 
 	test_smalles1sidescycle();
+	test_smallest1SidedCycleBatches();
+	test_signalParityIndex();
 	test_allFacialWalks();
 	test_allFacialWalks2();
 	test_allFacialWalks3();
 	test_allFacialWalks4();
+	test_dualGraph();
+	test_splitFace();
+	test_edgeWidth();
+	test_homologyIndex();
+	test_faceWidth();
 }
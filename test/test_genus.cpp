@@ -0,0 +1,62 @@
+#include <iostream>
+#include <cassert>
+
+#include <boost/graph/adjacency_list.hpp>
+
+#include <gdraw/graph_types.hpp>
+#include <gdraw/generators.hpp>
+#include <gdraw/embedded_graphs.hpp>
+#include <gdraw/genus.hpp>
+
+#define ASSERT(x) { if (!(x)) std::cout << __FUNCTION__ << " failed on line " << __LINE__ << std::endl; }
+
+using AdjList = boost::adjacency_list<
+	boost::vecS
+	,boost::vecS
+	,boost::undirectedS
+	,boost::property<boost::vertex_index_t,size_t>
+	,boost::property<boost::edge_index_t,size_t>
+	>; 
+
+using namespace gdraw;
+
+template <int EulerGenus>
+auto embedsWithGenus(IndexedGraph<AdjList> g, size_t threads = 1){
+	auto v = orientableEmbedding<EulerGenus>(std::move(g),threads);
+	if(std::holds_alternative<NonEmbeddableGraph<AdjList>>(v))
+		return false;
+	return eulerGenus(std::get<0>(v)) <= EulerGenus;
+}
+
+auto test_eulerGenus()
+{
+	auto v = planeEmbedding(IndexedGraph<AdjList>{getKn<AdjList>(4)});
+	ASSERT(eulerGenus(std::get<0>(v)) == 0);
+
+	auto h = IndexedGraph<AdjList>{getKn<AdjList>(5)};
+	h.addVertex();
+	auto w = torusEmbedding(std::move(h));
+	ASSERT(std::holds_alternative<ToroidalGraph<AdjList>>(w));
+	if(std::holds_alternative<ToroidalGraph<AdjList>>(w))
+		ASSERT(eulerGenus(std::get<0>(w)) == 2);
+}
+
+auto test_orientableEmbedding()
+{
+	ASSERT(embedsWithGenus<0>(IndexedGraph<AdjList>{getKn<AdjList>(4)}));
+	ASSERT(!embedsWithGenus<0>(IndexedGraph<AdjList>{getKpq<AdjList>(3,3)}));
+	ASSERT(embedsWithGenus<2>(IndexedGraph<AdjList>{getKpq<AdjList>(3,3)}));
+	ASSERT(embedsWithGenus<2>(IndexedGraph<AdjList>{getKpq<AdjList>(4,4)},3));
+	ASSERT(embedsWithGenus<2>(IndexedGraph<AdjList>{getKn<AdjList>(7)},2));
+	//genus 2 graphs
+	ASSERT(!embedsWithGenus<2>(IndexedGraph<AdjList>{getKn<AdjList>(8)}));
+	ASSERT(!embedsWithGenus<2>(IndexedGraph<AdjList>{getKpq<AdjList>(3,7)},2));
+	ASSERT(embedsWithGenus<4>(IndexedGraph<AdjList>{getKpq<AdjList>(3,7)}));
+}
+
+int main(){
+	std::cout << "Testing : " << __FILE__ << std::endl;
+
+	test_eulerGenus();
+	test_orientableEmbedding();
+}
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <cassert>
+#include <set>
+#include <algorithm>
 
 
 #include <boost/graph/adjacency_list.hpp>
@@ -9,6 +11,7 @@
 #include <gdraw/generators.hpp>
 #include <gdraw/util.hpp>
 #include <gdraw/planar_graphs.hpp>
+#include <gdraw/spqr_tree.hpp>
 
 #define ASSERT(x) { if (!(x)) std::cout << __FUNCTION__ << " failed on line " << __LINE__ << std::endl; }
 
@@ -93,6 +96,85 @@ auto test_maximal(){
 	ASSERT(num_edges(pg.getGraph()) == 3*(n+1) - 6);
 }
 
+auto test_maximalFaces(){
+	//a star, a grid and two disjoint cycles with an isolated vertex
+	std::vector<IndexedGraph<AdjList>> graphs;
+	auto star = IndexedGraph<AdjList>{AdjList(8)};
+	for(size_t i=1; i<8; i++)
+		star.addEdge(0,i);
+	graphs.push_back(std::move(star));
+	graphs.push_back(IndexedGraph<AdjList>{genGrid<AdjList>(6,4)});
+	auto cycles = IndexedGraph<AdjList>{AdjList(9)};
+	for(size_t i=0; i<4; i++){
+		cycles.addEdge(i,(i+1)%4);
+		cycles.addEdge(4+i,4+(i+1)%4);
+	}
+	graphs.push_back(std::move(cycles));
+
+	for(auto&& g : graphs){
+		auto n = g.numVertices();
+		auto pg = makeMaximal(std::get<PlanarGraph<AdjList>>(planeEmbedding(g)));
+		ASSERT(pg.numEdges() == 3*n - 6);
+		ASSERT(pg.edge_signals.size() == pg.numEdges());
+
+		std::vector<bool> seen(pg.numEdges(),false);
+		std::set<std::pair<size_t,size_t>> pairs;
+		for(auto&& e : pg.edges()){
+			ASSERT(pg.index(e) < seen.size() && !seen[pg.index(e)]);
+			seen[pg.index(e)] = true;
+			auto [u,v] = pg.endpoints(e);
+			pairs.insert(std::minmax(pg.index(u),pg.index(v)));
+		}
+		ASSERT(pairs.size() == pg.numEdges());
+
+		//every face is a triangle
+		std::vector<std::vector<vertex_t<AdjList>>> faces;
+		FacialCyclesVisitor<vertex_t<AdjList>> visitor {faces};
+		auto rotations_pmap = make_iterator_property_map(pg.rotations.begin(),get(boost::vertex_index,pg.getGraph()));
+		planar_face_traversal(pg.getGraph(),rotations_pmap,visitor);
+		ASSERT(faces.size() == 2*n - 4);
+		ASSERT(std::all_of(faces.begin(),faces.end(),[](auto& f){ return f.size() == 3; }));
+	}
+}
+
+auto test_faceTable(){
+	auto g = IndexedGraph<AdjList>{genGrid<AdjList>(5,4)};
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(g));
+	auto n = pg.numVertices();
+	auto m = pg.numEdges();
+
+	auto table = faceTable(pg);
+	ASSERT(table.numFaces() == m - n + 2);
+	ASSERT(table.vertices.size() == 2*m);
+
+	//the same faces as Boost's traversal
+	std::vector<std::vector<vertex_t<AdjList>>> faces;
+	FacialCyclesVisitor<vertex_t<AdjList>> visitor {faces};
+	auto rotations_pmap = make_iterator_property_map(pg.rotations.begin(),get(boost::vertex_index,pg.getGraph()));
+	planar_face_traversal(pg.getGraph(),rotations_pmap,visitor);
+	std::multiset<size_t> sizes, table_sizes;
+	for(auto&& f : faces)
+		sizes.insert(f.size());
+	for(size_t f=0; f<table.numFaces(); f++)
+		table_sizes.insert(table.face(f).size());
+	ASSERT(sizes == table_sizes);
+
+	//each dart is on the face it leaves from
+	for(auto&& e : pg.edges()){
+		auto [u,v] = pg.endpoints(e);
+		auto i = pg.index(e);
+		auto f = table.face(table.face_of[2*i]);
+		ASSERT(std::find(f.begin(),f.end(),u) != f.end());
+		f = table.face(table.face_of[2*i+1]);
+		ASSERT(std::find(f.begin(),f.end(),v) != f.end());
+	}
+
+	auto first = faceTable(pg,1);
+	ASSERT(first.numFaces() == 1);
+	ASSERT(findFacialCycle(pg).size() == first.face(0).size());
+	ASSERT(findLargestFacialCycle(pg).size() == 14);
+}
+
 auto test_isolateKuratowskiSubgraph(){
 	using Graph = AdjList;
 	auto g = IndexedGraph{getKpq<Graph>(5,5)};
@@ -132,11 +214,99 @@ auto test_isolateKuratowskiSubgraph(){
 
 }
 
+auto test_spqrTree(){
+	//checks that the embeddings are planar and pairwise different
+	auto embeddings = [](const IndexedGraph<AdjList>& g){
+		SPQRTree<AdjList> tree(g);
+		std::set<std::vector<std::vector<size_t>>> seen;
+		size_t count = 0;
+		for(auto&& rotations : tree.embeddings()){
+			count++;
+			std::vector<std::vector<size_t>> normalized;
+			for(auto&& r : rotations){
+				std::vector<size_t> indices;
+				for(auto&& e : r)
+					indices.push_back(g.index(e));
+				std::rotate(indices.begin(),std::min_element(indices.begin(),indices.end()),indices.end());
+				normalized.push_back(indices);
+			}
+			seen.insert(normalized);
+
+			auto pg = PlanarGraph<AdjList>(IndexedGraph<AdjList>(g),std::move(rotations),std::vector<int>(g.numEdges(),1));
+			ASSERT(faceTable(pg).numFaces() + g.numVertices() == g.numEdges() + 2);
+		}
+		ASSERT(count == tree.numEmbeddings());
+		ASSERT(seen.size() == count);
+		return std::make_pair(tree.numNodes(),count);
+	};
+
+	auto k4 = IndexedGraph<AdjList>{getKn<AdjList>(4)};
+	ASSERT(embeddings(k4) == std::make_pair((size_t)1,(size_t)2));
+
+	auto cycle = IndexedGraph<AdjList>{genCycle<AdjList>(6)};
+	ASSERT(embeddings(cycle) == std::make_pair((size_t)1,(size_t)1));
+
+	//two cycles and the chord in a bond
+	auto chorded = IndexedGraph<AdjList>{genCycle<AdjList>(6)};
+	chorded.addEdge(chorded.vertex(0),chorded.vertex(3));
+	ASSERT(embeddings(chorded) == std::make_pair((size_t)3,(size_t)2));
+
+	//a bond of four paths
+	auto k24 = IndexedGraph<AdjList>{getKpq<AdjList>(2,4)};
+	ASSERT(embeddings(k24) == std::make_pair((size_t)5,(size_t)6));
+
+	//two K4 glued on an edge, plus a path between the glued vertices
+	auto glued = IndexedGraph<AdjList>{getKn<AdjList>(4)};
+	for(size_t i=0; i<3; i++)
+		glued.addVertex();
+	glued.addEdge(glued.vertex(0),glued.vertex(4));
+	glued.addEdge(glued.vertex(1),glued.vertex(4));
+	glued.addEdge(glued.vertex(0),glued.vertex(5));
+	glued.addEdge(glued.vertex(1),glued.vertex(5));
+	glued.addEdge(glued.vertex(4),glued.vertex(5));
+	glued.addEdge(glued.vertex(0),glued.vertex(6));
+	glued.addEdge(glued.vertex(6),glued.vertex(1));
+	SPQRTree<AdjList> tree(glued);
+	std::vector<size_t> types(3,0);
+	for(size_t i=0; i<tree.numNodes(); i++)
+		types[(size_t)tree.node(i).type]++;
+	ASSERT(types == std::vector<size_t>({1,1,2}));
+	ASSERT(embeddings(glued).second == 3*2*2*2);
+	auto [node,position] = tree.skeletonEdge(glued.index(glued.edge(0,1).value()));
+	ASSERT(tree.node(node).type == SPQRTree<AdjList>::NodeType::P);
+	ASSERT(tree.node(node).edges[position].real == glued.index(glued.edge(0,1).value()));
+
+	auto k5 = IndexedGraph<AdjList>{getKn<AdjList>(5)};
+	SPQRTree<AdjList> k5_tree(k5);
+	ASSERT(!k5_tree.isPlanar());
+	ASSERT(k5_tree.numEmbeddings() == 0);
+
+	//a long ladder, whose tree is a path of cycles and bonds deeper than the call stack would allow
+	size_t rungs = 100000;
+	auto ladder = IndexedGraph<AdjList>{AdjList(2*rungs)};
+	for(size_t r=0; r<rungs; r++){
+		ladder.addEdge(ladder.vertex(2*r),ladder.vertex(2*r+1));
+		if(r+1 < rungs){
+			ladder.addEdge(ladder.vertex(2*r),ladder.vertex(2*r+2));
+			ladder.addEdge(ladder.vertex(2*r+1),ladder.vertex(2*r+3));
+		}
+	}
+	SPQRTree<AdjList> ladder_tree(ladder);
+	ASSERT(ladder_tree.numNodes() == 2*rungs - 3);
+	auto rotations = *ladder_tree.embeddings().begin();
+	ASSERT(std::all_of(rotations.begin(),rotations.end(),[](auto& r){ return r.size() == 3 || r.size() == 2; }));
+	auto pg = PlanarGraph<AdjList>(IndexedGraph<AdjList>(ladder),std::move(rotations),std::vector<int>(ladder.numEdges(),1));
+	ASSERT(faceTable(pg).numFaces() == rungs);
+}
+
 int main(){
 	std::cout << "Testing : " << __FILE__ << std::endl;
 
 	test_isPlanar();
 	test_maximal();
+	test_maximalFaces();
+	test_faceTable();
+	test_spqrTree();
 	test_largestfacialcycle();
 	test_isolateKuratowskiSubgraph();
 }
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cassert>
+#include <sstream>
 
 
 #include <boost/graph/adjacency_list.hpp>
@@ -26,10 +27,15 @@ using namespace gdraw;
 auto test_doubleCover()
 {
 	auto g = IndexedGraph<AdjList>{gdraw::getKpq<AdjList>(3,3)};
-	add_edge(0,1,g.getGraph());
+	g.addEdge(0,1);
 
 	std::vector<edge_t<AdjList>> xedges = {edge(0,3,g.getGraph()).first,edge(1,4,g.getGraph()).first,edge(2,5,g.getGraph()).first};
 
+	std::vector<edge_t<AdjList>> h_edges(num_edges(g.getGraph()));
+	auto h = g;
+	for(auto&& e : h.edges())
+		h_edges[h.index(e)] = e;
+
 	auto n = num_vertices(g.getGraph());
 	auto m = num_edges(g.getGraph());
 
@@ -40,6 +46,13 @@ auto test_doubleCover()
 
 	ASSERT(nc == 2*n);
 	ASSERT(mc == 2*m);
+
+	//the edge with index j is a lift of the edge with index j mod m
+	for(auto&& e : dc.edges()){
+		auto [u,v] = dc.endpoints(e);
+		auto [a,b] = endpoints(h.getGraph(),h_edges[dc.index(e) % m]);
+		ASSERT((u%n == a && v%n == b) || (u%n == b && v%n == a));
+	}
 }
 
 auto test_doublePlanarCover()
@@ -52,6 +65,43 @@ auto test_doublePlanarCover()
 	ASSERT(result);
 }
 
+auto test_doublePlanarCoverPortfolio()
+{
+	auto g = IndexedGraph<AdjList>{gdraw::getKn<AdjList>(6)};
+
+	std::ostringstream log;
+	auto result = findDoublePlanarCoverPortfolio(std::move(g),4,7,log);
+
+	ASSERT(result);
+	ASSERT(log.str().find("seed") != std::string::npos);
+}
+
+auto test_embeddingFromDPC()
+{
+	auto g = IndexedGraph<AdjList>{gdraw::getKn<AdjList>(6)};
+
+	auto result = findDoublePlanarCover(std::move(g),3);
+
+	ASSERT(result);
+
+	auto ppg = embeddingFromDPC(std::move(result.value()));
+
+	ASSERT(ppg.numVertices() == 6);
+	ASSERT(ppg.numEdges() == 15);
+
+	for(auto&& v : ppg.vertices())
+		ASSERT(ppg.rotations[v].size() == ppg.degree(v));
+
+	//Euler's formula on the projective plane: V - E + F = 1
+	ASSERT(allFacialWalks(ppg).size() == 10);
+
+	//lifting the embedding back gives a planar double cover
+	auto dpc = doublePlanarCover(std::move(ppg),5);
+
+	ASSERT(dpc.numVertices() == 12);
+	ASSERT(dpc.numEdges() == 30);
+}
+
 auto test_embedk33(){
 	auto g = IndexedGraph<AdjList>{getKpq<AdjList>(3,3)};
 
@@ -109,6 +159,8 @@ int main(){
 
 	test_doubleCover();
 	test_doublePlanarCover();
+	test_doublePlanarCoverPortfolio();
+	test_embeddingFromDPC();
 	test_embedk33();
 	test_embedk332();
 }
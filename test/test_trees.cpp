@@ -84,6 +84,15 @@ auto test_fundamentalcycle(){
 	ASSERT(cycle.size()==5);
 }
 
+auto test_randomspanningtree(){
+	auto g = IndexedGraph{getKn<AdjList>(7)};
+
+	auto tree = randomSpanningTree(g,42);
+	auto same_tree = randomSpanningTree(g,42);
+
+	ASSERT(tree.size()==6);
+	ASSERT(tree == same_tree);
+}
 
 int main(){
 	std::cout << "Testing : " << __FILE__ << std::endl;
@@ -92,4 +101,5 @@ int main(){
 	test_findcycle2();
 	test_findcycle3();
 	test_fundamentalcycle();
+	test_randomspanningtree();
 }
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 
 #include <boost/graph/adjacency_list.hpp>
@@ -9,6 +10,8 @@
 #include <gdraw/generators.hpp>
 #include <gdraw/util.hpp>
 #include <gdraw/xnumber.hpp>
+#include <gdraw/draw.hpp>
+#include <gdraw/crossings.hpp>
 
 #define ASSERT(x) { if (!(x)) std::cout << __FUNCTION__ << " failed on line " << __LINE__ << std::endl; }
 
@@ -50,7 +53,190 @@ auto test_planarXNumber4()
 	ASSERT(planarXNumber(std::move(l),1));
 }
 
+auto test_flattenedCrossings()
+{
+	auto k = IndexedGraph<AdjList>{gdraw::getKn<AdjList>(6)};
+	auto n = k.numVertices();
+	auto result = planarXNumber(std::move(k),3);
+	ASSERT(result);
+	if(result){
+		//the planarization on the grid
+		auto sg = schnyderDraw(result.value());
+		ASSERT(isStraightLineDrawing(sg));
+		auto fg = drawFlattenedGraph(result.value(),n,schnyderDraw<AdjList>);
+		ASSERT(fg.numEdges() == 15);
+
+		auto dg = drawFlattenedGraph(std::move(result.value()),n);
+		auto [count,pairs] = countCrossings(dg);
+		ASSERT(count == 3);
+		ASSERT(pairs.size() == 3);
+	}
+}
+
+auto test_projectivePlaneEmbedding()
+{
+	//K6 with an isolated vertex
+	auto g = IndexedGraph<AdjList>{gdraw::getKn<AdjList>(6)};
+	g.addVertex();
+
+	auto v = projectivePlaneEmbedding(std::move(g),1);
+	ASSERT(std::holds_alternative<ProjectivePlanarGraph<AdjList>>(v));
+	if(std::holds_alternative<ProjectivePlanarGraph<AdjList>>(v)){
+		auto& pp = std::get<0>(v);
+		ASSERT(pp.numVertices() == 7);
+		ASSERT(pp.rotations[6].empty());
+		ASSERT(gdraw::allFacialWalks(pp).size() == 10);
+	}
+
+	auto h = IndexedGraph<AdjList>{gdraw::getKpq<AdjList>(3,5)};
+	auto w = projectivePlaneEmbedding(std::move(h),1);
+	ASSERT(std::holds_alternative<NonEmbeddableGraph<AdjList>>(w));
+	if(std::holds_alternative<NonEmbeddableGraph<AdjList>>(w)){
+		//the obstruction is itself not projective-planar
+		auto& neg = std::get<1>(w);
+		auto [s,s_map] = createSubgraph(neg,neg.forbidden_subgraph);
+		ASSERT(std::holds_alternative<NonEmbeddableGraph<AdjList>>(projectivePlaneEmbedding(std::move(s),2)));
+	}
+}
+
+auto test_projectiveXNumber()
+{
+	auto g = IndexedGraph<AdjList>{gdraw::getKpq<AdjList>(3,5)};
+	ASSERT(!projectiveXNumber(g,0,2,1));
+
+	auto result = projectiveXNumber(g,1,2,1);
+	ASSERT(result);
+	if(result){
+		auto& pp = result.value();
+		ASSERT(pp.numVertices() == 9);
+		ASSERT(pp.numEdges() == 17);
+		//Euler characteristic of the projective plane
+		ASSERT((int)pp.numVertices() - (int)pp.numEdges() + (int)gdraw::allFacialWalks(pp).size() == 1);
+	}
+
+	//the rounds stop at the first crossing that suffices
+	auto more = projectiveXNumber(g,2,3,1);
+	ASSERT(more && more->numVertices() == 9);
+
+	auto k33 = projectiveXNumber(IndexedGraph<AdjList>{gdraw::getKpq<AdjList>(3,3)},2,2,1);
+	ASSERT(k33 && k33->numVertices() == 6);
+}
+
+
+
+auto test_singleEdgeInsertion()
+{
+	//checks that the rotations of the planarization are a plane embedding
+	auto plane = [](const auto& pg){
+		return faceTable(pg).numFaces() + pg.numVertices() == pg.numEdges() + 2;
+	};
+
+	auto k4 = singleEdgeInsertion(IndexedGraph<AdjList>{getKn<AdjList>(4)});
+	ASSERT(k4 && k4->crossings == 0 && k4->exact);
+
+	ASSERT(!singleEdgeInsertion(IndexedGraph<AdjList>{getKn<AdjList>(6)}));
+
+	auto k33 = singleEdgeInsertion(IndexedGraph<AdjList>{getKpq<AdjList>(3,3)});
+	ASSERT(k33 && k33->crossings == 1 && k33->exact);
+
+	auto k5 = singleEdgeInsertion(IndexedGraph<AdjList>{getKn<AdjList>(5)});
+	ASSERT(k5 && k5->crossings == 1 && k5->exact);
+	if(k5){
+		ASSERT(plane(k5->planarization));
+		ASSERT(k5->planarization.numVertices() == 6);
+		auto dg = drawFlattenedGraph(std::move(k5->planarization),5);
+		ASSERT(dg.numVertices() == 5 && dg.numEdges() == 10);
+		std::vector<bool> seen(10,false);
+		for(auto&& e : dg.edges())
+			seen[dg.index(e)] = true;
+		ASSERT(std::all_of(seen.begin(),seen.end(),[](auto b){ return b; }));
+		auto [count,pairs] = countCrossings(dg);
+		ASSERT(count == 1);
+	}
+
+	//a 5x5 grid with an edge between two inner vertices two cells apart diagonally
+	auto grid = IndexedGraph<AdjList>{AdjList(25)};
+	size_t index = 0;
+	for(size_t i=0; i<5; i++)
+		for(size_t j=0; j<5; j++){
+			if(j<4)
+				grid.addEdge(grid.vertex(5*i+j),grid.vertex(5*i+j+1),index++);
+			if(i<4)
+				grid.addEdge(grid.vertex(5*i+j),grid.vertex(5*i+j+5),index++);
+		}
+	grid.addEdge(grid.vertex(6),grid.vertex(18),index++);
+	auto diagonal = singleEdgeInsertion(std::move(grid));
+	ASSERT(diagonal && diagonal->crossings == 2 && !diagonal->exact);
+	if(diagonal){
+		ASSERT(plane(diagonal->planarization));
+		auto dg = drawFlattenedGraph(std::move(diagonal->planarization),25);
+		ASSERT(dg.numEdges() == 41);
+		ASSERT(dg.edge(dg.vertex(6),dg.vertex(18)));
+	}
+}
 
+auto test_insertionEmbedding()
+{
+	//the crossings of the shortest insertion into the embedding given by the rotations, which hold edges of g
+	auto crossings = [](const IndexedGraph<AdjList>& g, const rotations_t<AdjList>& rotations, size_t s, size_t t){
+		auto pg = PlanarGraph<AdjList>(IndexedGraph<AdjList>(g),rotations_t<AdjList>(g.numVertices()),std::vector<int>(g.numEdges(),1));
+		std::vector<edge_t<AdjList>> edges_by_index(g.numEdges());
+		for(auto&& e : pg.edges())
+			edges_by_index[pg.index(e)] = e;
+		for(size_t v=0; v<rotations.size(); v++)
+			for(auto&& e : rotations[v])
+				pg.rotations[v].push_back(edges_by_index[g.index(e)]);
+		return insertionPath(pg,dualGraph(pg),edges_by_index,s,t)->sides.size();
+	};
+
+	//two K4 glued on an edge with a path between the glued vertices, a bond of four paths and a grid, against all their embeddings
+	auto glued = IndexedGraph<AdjList>{getKn<AdjList>(4)};
+	for(size_t i=0; i<3; i++)
+		glued.addVertex();
+	for(auto&& [u,v] : {std::pair{0,4},{1,4},{0,5},{1,5},{4,5},{0,6},{6,1}})
+		glued.addEdge(glued.vertex(u),glued.vertex(v));
+	std::vector<IndexedGraph<AdjList>> graphs;
+	graphs.push_back(std::move(glued));
+	graphs.push_back(IndexedGraph<AdjList>{getKpq<AdjList>(2,4)});
+	graphs.push_back(IndexedGraph<AdjList>{genGrid<AdjList>(5,5)});
+	size_t most = 0;
+	for(auto&& g : graphs){
+		SPQRTree<AdjList> tree(g);
+		for(size_t s=0; s<g.numVertices(); s++)
+			for(size_t t=s+1; t<g.numVertices(); t++){
+				size_t fewest = std::numeric_limits<size_t>::max();
+				for(auto&& rotations : tree.embeddings())
+					fewest = std::min(fewest,crossings(g,rotations,s,t));
+				auto [rotations,count] = tree.insertionEmbedding(s,t);
+				ASSERT(count == fewest && crossings(g,rotations,s,t) == fewest);
+				most = std::max(most,fewest);
+			}
+	}
+	ASSERT(most == 2);
+
+	//two 5x5 grids sharing a corner, where the centers are two crossings away from the corner in each
+	auto grids = IndexedGraph<AdjList>{AdjList(49)};
+	auto vertex = [](size_t grid, size_t i, size_t j) -> size_t{
+		return grid == 0 || i+j > 0 ? 24*grid + 5*i + j : 0;
+	};
+	for(size_t grid=0; grid<2; grid++)
+		for(size_t i=0; i<5; i++)
+			for(size_t j=0; j<5; j++){
+				if(j<4)
+					grids.addEdge(grids.vertex(vertex(grid,i,j)),grids.vertex(vertex(grid,i,j+1)));
+				if(i<4)
+					grids.addEdge(grids.vertex(vertex(grid,i,j)),grids.vertex(vertex(grid,i+1,j)));
+			}
+	auto pg = std::get<PlanarGraph<AdjList>>(planeEmbedding(std::move(grids)));
+	auto embedding = insertionEmbedding(pg,vertex(0,2,2),vertex(1,2,2));
+	ASSERT(embedding && embedding->second == 4);
+	if(embedding){
+		pg.rotations = std::move(embedding->first);
+		auto [planarization,count] = insertEdge(std::move(pg),vertex(0,2,2),vertex(1,2,2));
+		ASSERT(count == 4);
+		ASSERT(faceTable(planarization).numFaces() + planarization.numVertices() == planarization.numEdges() + 2);
+	}
+}
 
 int main(){
 	std::cout << "Testing : " << __FILE__ << std::endl;
@@ -59,4 +245,9 @@ int main(){
 	test_planarXNumber2();
 	test_planarXNumber3();
 	test_planarXNumber4();
+	test_flattenedCrossings();
+	test_singleEdgeInsertion();
+	test_insertionEmbedding();
+	test_projectivePlaneEmbedding();
+	test_projectiveXNumber();
 }
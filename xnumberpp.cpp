@@ -0,0 +1,36 @@
+#include <iostream>
+
+#include <boost/graph/adjacency_list.hpp>
+
+#include <gdraw/xnumber.hpp>
+#include <gdraw/io.hpp>
+
+using AdjList = boost::adjacency_list<
+boost::vecS
+,boost::vecS
+,boost::undirectedS
+,boost::property<boost::vertex_index_t,size_t>
+,boost::property<boost::edge_index_t,size_t>
+>; 
+
+int main(int argc, char *argv[]){
+	using namespace gdraw;
+
+	if(argc < 2 || argc > 4){
+		std::cout << "Usage: ./xnumberpp <k> [<threads>] [<seed>] < <graph>" << std::endl; 
+		std::cout << "Where <k> is the queried crossing number in the projective plane, <threads> the number of threads used (default 1) and <seed> seeds the spanning trees of the double cover search." << std::endl;
+		std::cout << "If the crossing number of <graph> is <= <k> the output will be the embedding of the graph with its crossings replaced by new vertices." << std::endl;
+		return 0;
+	}
+
+	size_t k = atoi(argv[1]);
+	size_t threads = argc > 2 ? atoi(argv[2]) : 1;
+	seed_t seed = argc > 3 ? strtoul(argv[3],nullptr,10) : randomSeed();
+
+	auto g = IndexedGraph{readDOT<AdjList>()};
+
+	auto result = projectiveXNumber(std::move(g),k,threads,seed);
+
+	if(result)
+		printEmbedding(result.value());
+}